@@ -0,0 +1,221 @@
+#include "BatchProcessor.h"
+#include "ButterflySubdivision.h"
+#include "LoopSubdivision.h"
+#include "MemoryEstimate.h"
+#include "ObjLoader.h"
+#include "OutOfCoreSubdivision.h"
+#include "SoftwareRasterizer.h"
+#include "Sqrt3Subdivision.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+BatchProcessor::BatchProcessor(int threadCount, size_t largeAssetBytes, size_t packBytes, size_t memoryBudget)
+    : pool(threadCount), largeAssetBytes(largeAssetBytes), packBytes(packBytes), memoryBudget(memoryBudget) {}
+
+bool BatchProcessor::readManifest(const std::string& filename, std::vector<BatchJob>& jobs)
+{
+    std::ifstream manifest(filename);
+    if (!manifest.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(manifest, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream ss(line);
+        BatchJob job;
+        if (!(ss >> job.inputFile >> job.scheme >> job.levels >> job.outputFile)) {
+            std::cerr << filename << ":" << lineNumber << ": expected <input.obj> <loop|butterfly> <levels> <output.obj> [thumbnail.png]" << std::endl;
+            return false;
+        }
+        ss >> job.thumbnailFile;
+        jobs.push_back(job);
+    }
+
+    return true;
+}
+
+std::vector<BatchResult> BatchProcessor::run(const std::vector<BatchJob>& jobs)
+{
+    std::vector<BatchResult> results(jobs.size());
+    ThreadPool::TaskGroup assetTasks;
+
+    // pack small assets together, so a task is worth the scheduling
+    std::vector<size_t> pack;
+    size_t packedBytes = 0;
+    auto submitPack = [&]() {
+        if (pack.empty())
+            return;
+        pool.submit([this, &jobs, &results, pack]() {
+            for (size_t idx : pack) {
+                runAsset(jobs[idx], results[idx], false);
+            }
+        }, &assetTasks);
+        pack.clear();
+        packedBytes = 0;
+    };
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        long long size = fileSize(jobs[i].inputFile);
+
+        if (size >= 0 && static_cast<size_t>(size) >= largeAssetBytes) {
+            pool.submit([this, &jobs, &results, i]() { runAsset(jobs[i], results[i], true); }, &assetTasks);
+            continue;
+        }
+
+        pack.push_back(i);
+        packedBytes += size > 0 ? static_cast<size_t>(size) : 0;
+        if (packedBytes >= packBytes) {
+            submitPack();
+        }
+    }
+    submitPack();
+
+    pool.wait(assetTasks);
+    return results;
+}
+
+void BatchProcessor::runAsset(const BatchJob& job, BatchResult& result, bool outOfCore)
+{
+    result.inputFile = job.inputFile;
+    result.outputFile = job.outputFile;
+    result.thumbnailFile = job.thumbnailFile;
+    result.outOfCore = outOfCore;
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        LoopSubdivision loop = LoopSubdivision();
+        ButterflySubdivision butterfly = ButterflySubdivision();
+        Sqrt3Subdivision sqrt3 = Sqrt3Subdivision();
+
+        bool isLoop = job.scheme == "loop";
+        bool isSqrt3 = job.scheme == "sqrt3";
+        if (!isLoop && !isSqrt3 && job.scheme != "butterfly")
+            throw std::runtime_error("unknown subdivision scheme: " + job.scheme);
+        if (job.levels < 1)
+            throw std::runtime_error("levels must be at least 1");
+        // only Butterfly interpolates
+        bool moveVertices = isLoop || isSqrt3;
+
+        TriangleSubdivison& scheme = isSqrt3 ? static_cast<TriangleSubdivison&>(sqrt3) : isLoop ? static_cast<TriangleSubdivison&>(loop) : butterfly;
+        scheme.setThreadPool(&pool);
+
+        // assets without attribute channels are subdivided in the smaller directed-edge form
+        std::unique_ptr<Mesh> mesh;
+        std::unique_ptr<TriangleMesh> triangleMesh;
+        if (!outOfCore) {
+            MeshArrays arrays;
+            std::vector<AttributeChannel> channels;
+            loadOBJ(job.inputFile, arrays, channels, &pool);
+            if (arrays.faceCount() == 0)
+                throw std::runtime_error("no faces loaded");
+
+            // the base mesh is small, the levels decide whether the asset fits in memory
+            if (channels.empty()) {
+                triangleMesh.reset(new TriangleMesh(std::move(arrays)));
+                result.predictedPeakBytes = isSqrt3 ? sqrt3.predictPeakBytes(*triangleMesh, job.levels) : triangleMesh->predictPeakBytes(job.levels);
+            }
+            else {
+                mesh.reset(new Mesh(arrays, 0.0f, &pool));
+                mesh->channels = channels;
+                result.predictedPeakBytes = (isSqrt3 ? MemoryEstimate::predictSqrt3(*mesh, job.levels, 0)
+                    : MemoryEstimate::predict(*mesh, job.levels, moveVertices)).back().peakBytes;
+            }
+            if (result.predictedPeakBytes > memoryBudget) {
+                mesh.reset();
+                triangleMesh.reset();
+                outOfCore = true;
+                result.outOfCore = true;
+            }
+        }
+
+        if (outOfCore && isSqrt3)
+            throw std::runtime_error("sqrt3 has no out-of-core path, the asset does not fit the memory budget");
+        if (outOfCore) {
+            // large assets are split into patches, those become tasks of the same pool
+            // the halo around a patch is as wide as the stencil of the scheme
+            OutOfCoreSubdivision subdivision(scheme, moveVertices, isLoop ? 1 : 2, isLoop ? 1 : 3);
+            subdivision.setThreadPool(&pool);
+            if (!subdivision.subdivide(job.inputFile, job.outputFile, job.levels))
+                throw std::runtime_error("out-of-core subdivision failed");
+        }
+        else {
+            for (int level = 0; level < job.levels; ++level) {
+                if (triangleMesh)
+                    scheme.subdivide(*triangleMesh, moveVertices);
+                else
+                    scheme.subdivide(mesh.get(), moveVertices);
+                result.peakBytes = std::max(result.peakBytes, scheme.getPeakBytes());
+            }
+
+            if (triangleMesh ? !saveOBJ(job.outputFile, *triangleMesh) : !saveOBJ(job.outputFile, *mesh))
+                throw std::runtime_error("could not write " + job.outputFile);
+            result.outputFaces = triangleMesh ? triangleMesh->faceCount() : mesh->faces.size();
+
+            if (!job.thumbnailFile.empty()) {
+                // the rasterizer reads a Mesh, built only for the thumbnail
+                if (triangleMesh) {
+                    mesh.reset(triangleMesh->toMesh());
+                    triangleMesh.reset();
+                }
+                SoftwareRasterizer rasterizer(thumbnailSize, thumbnailSize, &pool);
+                rasterizer.render(*mesh, GOURAUD);
+                if (!rasterizer.save(job.thumbnailFile))
+                    throw std::runtime_error("could not write " + job.thumbnailFile);
+            }
+        }
+        result.success = true;
+    }
+    catch (const std::exception& e) {
+        result.success = false;
+        result.error = e.what();
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BatchProcessor::printReport(const std::vector<BatchResult>& results, std::ostream& out)
+{
+    int failures = 0;
+    double totalMilliseconds = 0.0;
+
+    for (const BatchResult& result : results) {
+        totalMilliseconds += result.milliseconds;
+        if (result.success) {
+            out << "OK     " << result.milliseconds << " ms  " << result.inputFile << " -> " << result.outputFile;
+            if (result.outOfCore && !result.thumbnailFile.empty())
+                out << " (out-of-core, no thumbnail)";
+            else if (result.outOfCore && result.predictedPeakBytes > 0)
+                out << " (out-of-core, in memory it would need " << MemoryEstimate::formatBytes(result.predictedPeakBytes) << ")";
+            else if (result.outOfCore)
+                out << " (out-of-core)";
+            else
+                out << " (" << result.outputFaces << " faces, peak " << MemoryEstimate::formatBytes(result.peakBytes)
+                    << ", predicted " << MemoryEstimate::formatBytes(result.predictedPeakBytes) << ")";
+            out << std::endl;
+        }
+        else {
+            failures++;
+            out << "FAILED " << result.milliseconds << " ms  " << result.inputFile << ": " << result.error << std::endl;
+        }
+    }
+
+    out << results.size() - failures << " of " << results.size() << " assets subdivided, "
+        << failures << " failed, " << totalMilliseconds << " ms of work" << std::endl;
+}
+
+long long BatchProcessor::fileSize(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return -1;
+    return static_cast<long long>(file.tellg());
+}
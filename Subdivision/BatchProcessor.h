@@ -0,0 +1,56 @@
+#pragma once
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// One line of a batch manifest: <input.obj> <loop|butterfly|sqrt3> <levels> <output.obj> [thumbnail.png]
+struct BatchJob {
+    std::string inputFile;
+    std::string scheme;
+    int levels = 1;
+    std::string outputFile;
+    std::string thumbnailFile;
+};
+
+struct BatchResult {
+    std::string inputFile;
+    std::string outputFile;
+    std::string thumbnailFile;
+    bool success = false;
+    bool outOfCore = false;
+    std::string error;
+    double milliseconds = 0.0;
+    size_t outputFaces = 0;
+    size_t predictedPeakBytes = 0;
+    size_t peakBytes = 0;
+};
+
+// Subdivides many assets in one process on a shared work-stealing pool.
+// Assets above largeAssetBytes are split into patches that run as separate tasks, smaller ones
+// are packed into tasks of about packBytes of input. A small asset whose levels are predicted to
+// need more than memoryBudget falls back to the out-of-core path as well. Every asset writes its
+// own output file as soon as it is done, and a failing asset is reported without stopping the others.
+// Thumbnails are rendered with the software rasterizer, only for assets subdivided in memory.
+class BatchProcessor
+{
+public:
+    BatchProcessor(int threadCount = 0, size_t largeAssetBytes = 64 << 20, size_t packBytes = 4 << 20,
+        size_t memoryBudget = size_t(1) << 30);
+
+    static const int thumbnailSize = 512;
+
+    static bool readManifest(const std::string& filename, std::vector<BatchJob>& jobs);
+    std::vector<BatchResult> run(const std::vector<BatchJob>& jobs);
+    static void printReport(const std::vector<BatchResult>& results, std::ostream& out);
+
+private:
+    ThreadPool pool;
+    size_t largeAssetBytes;
+    size_t packBytes;
+    size_t memoryBudget;
+
+    void runAsset(const BatchJob& job, BatchResult& result, bool outOfCore);
+    static long long fileSize(const std::string& filename);
+};
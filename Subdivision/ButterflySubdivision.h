@@ -2,13 +2,53 @@
 
 #include "TriangleSubdivison.h"
 
-class ButterflySubdivision : public TriangleSubdivison {
+class ButterflySubdivision : public TriangleSubdivisonScheme<ButterflySubdivision> {
 public:
     ButterflySubdivision() = default;
 
 private:
-    Vertex* createBoundaryVertex(HalfEdge* he, Mesh* mesh);
-    Vertex* createInteriorVertex(HalfEdge* he, Mesh* mesh);
-    Vertex* moveVertex(Vertex* v, Mesh* mesh);
+    friend class TriangleSubdivisonScheme<ButterflySubdivision>;
+
+    // defined here, so they inline into the loops of TriangleSubdivisonScheme
+    template <class Topology>
+    void boundaryStencil(const Topology& mesh, typename Topology::HalfEdgeHandle he, BasicStencil<typename Topology::VertexHandle>& stencil)
+    {
+        // Midpoint of the edge
+        stencil.add(mesh.origin(he), 0.5f);
+        stencil.add(mesh.origin(mesh.twin(he)), 0.5f);
+    }
+
+    template <class Topology>
+    void interiorStencil(const Topology& mesh, typename Topology::HalfEdgeHandle he, BasicStencil<typename Topology::VertexHandle>& stencil)
+    {
+        auto twin = mesh.twin(he);
+        auto v0 = mesh.origin(he);
+        auto v1 = mesh.origin(twin);
+        auto v2 = mesh.origin(mesh.twin(mesh.next(he)));
+        auto v3 = mesh.origin(mesh.twin(mesh.next(twin)));
+
+        // Opposite vertices
+        auto v4 = mesh.origin(mesh.twin(mesh.next(mesh.twin(mesh.next(twin))))); // left lower wing
+        auto v5 = mesh.origin(mesh.twin(mesh.next(mesh.twin(mesh.next(mesh.next(twin)))))); // right lower wing
+        auto v6 = mesh.origin(mesh.twin(mesh.next(mesh.twin(mesh.next(mesh.next(he)))))); // left upper wing
+        auto v7 = mesh.origin(mesh.twin(mesh.next(mesh.twin(mesh.next(he)))));
+
+        // Butterfly formula
+        stencil.add(v0, 0.5f);
+        stencil.add(v1, 0.5f);
+        stencil.add(v2, 0.125f);
+        stencil.add(v3, 0.125f);
+        stencil.add(v4, -0.0625f);
+        stencil.add(v5, -0.0625f);
+        stencil.add(v6, -0.0625f);
+        stencil.add(v7, -0.0625f);
+    }
+
+    template <class Topology>
+    void vertexStencil(const Topology&, typename Topology::VertexHandle v, BasicStencil<typename Topology::VertexHandle>& stencil)
+    {
+        // interpolating scheme, the old vertices stay where they are
+        stencil.add(v, 1.0f);
+    }
 };
 
@@ -0,0 +1,222 @@
+#include "CompactMesh.h"
+
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+    // small deltas of either sign take a single byte
+    uint32_t zigZag(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    int32_t unZigZag(uint32_t value)
+    {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    void writeVarint(std::vector<uint8_t>& out, uint32_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint32_t readVarint(const uint8_t*& in)
+    {
+        uint32_t value = 0;
+        int shift = 0;
+        while (*in & 0x80) {
+            value |= static_cast<uint32_t>(*in++ & 0x7f) << shift;
+            shift += 7;
+        }
+        value |= static_cast<uint32_t>(*in++) << shift;
+        return value;
+    }
+
+    float signNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+}
+
+CompactMesh::CompactMesh(const Mesh& mesh)
+    : vertices(mesh.vertices.size()), faces(mesh.faces.size())
+{
+    float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int k = 0; k < 3; ++k) minPos[k] = FLT_MAX;
+    for (const Vertex* v : mesh.vertices) {
+        const float p[3] = { v->x, v->y, v->z };
+        for (int k = 0; k < 3; ++k) {
+            minPos[k] = std::min(minPos[k], p[k]);
+            maxPos[k] = std::max(maxPos[k], p[k]);
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        step[k] = vertices > 0 ? (maxPos[k] - minPos[k]) / 65535.0f : 0.0f;
+    }
+
+    std::unordered_map<const Vertex*, int> vertexIndex;
+    vertexIndex.reserve(vertices);
+    positions.reserve(vertices * 3);
+    bool withNormals = !mesh.vertexNormals.empty();
+    if (withNormals) normals.reserve(vertices * 2);
+
+    for (const Vertex* v : mesh.vertices) {
+        vertexIndex[v] = static_cast<int>(vertexIndex.size());
+
+        const float p[3] = { v->x, v->y, v->z };
+        for (int k = 0; k < 3; ++k) {
+            float q = step[k] > 0.0f ? std::round((p[k] - minPos[k]) / step[k]) : 0.0f;
+            positions.push_back(static_cast<uint16_t>(std::min(std::max(q, 0.0f), 65535.0f)));
+        }
+
+        if (withNormals) {
+            auto it = mesh.vertexNormals.find(const_cast<Vertex*>(v));
+            int16_t encoded[2] = { 0, 0 };
+            if (it != mesh.vertexNormals.end())
+                encodeNormal(it->second, encoded);
+            normals.push_back(encoded[0]);
+            normals.push_back(encoded[1]);
+        }
+    }
+
+    // corner count, then every index as a delta to the previous one
+    int previous = 0;
+    for (const Face* face : mesh.faces) {
+        std::vector<int> corners;
+        HalfEdge* startEdge = face->edge;
+        HalfEdge* currEdge = startEdge;
+        do {
+            corners.push_back(vertexIndex[currEdge->origin]);
+            currEdge = currEdge->next;
+        } while (currEdge != startEdge);
+
+        writeVarint(faceData, static_cast<uint32_t>(corners.size()));
+        for (int idx : corners) {
+            writeVarint(faceData, zigZag(idx - previous));
+            previous = idx;
+        }
+    }
+    faceData.shrink_to_fit();
+}
+
+size_t CompactMesh::vertexCount() const
+{
+    return vertices;
+}
+
+size_t CompactMesh::faceCount() const
+{
+    return faces;
+}
+
+void CompactMesh::position(size_t vertexIdx, float out[3]) const
+{
+    for (int k = 0; k < 3; ++k) {
+        out[k] = minPos[k] + positions[vertexIdx * 3 + k] * step[k];
+    }
+}
+
+bool CompactMesh::hasNormals() const
+{
+    return !normals.empty();
+}
+
+void CompactMesh::normal(size_t vertexIdx, float out[3]) const
+{
+    decodeNormal(&normals[vertexIdx * 2], out);
+}
+
+void CompactMesh::forEachFace(const std::function<void(const std::vector<int>& corners)>& visit) const
+{
+    const uint8_t* in = faceData.data();
+    std::vector<int> corners;
+    int previous = 0;
+
+    for (size_t f = 0; f < faces; ++f) {
+        uint32_t count = readVarint(in);
+        corners.resize(count);
+        for (uint32_t c = 0; c < count; ++c) {
+            previous += unZigZag(readVarint(in));
+            corners[c] = previous;
+        }
+        visit(corners);
+    }
+}
+
+Mesh* CompactMesh::toMesh() const
+{
+    MeshArrays arrays;
+    arrays.positions.resize(vertices * 3);
+    for (size_t i = 0; i < vertices; ++i) {
+        position(i, &arrays.positions[i * 3]);
+    }
+
+    arrays.faceOffsets.reserve(faces + 1);
+    forEachFace([&arrays](const std::vector<int>& corners) {
+        arrays.faceIndices.insert(arrays.faceIndices.end(), corners.begin(), corners.end());
+        arrays.endFace();
+    });
+
+    Mesh* mesh = new Mesh(arrays);
+
+    if (hasNormals()) {
+        for (size_t i = 0; i < vertices; ++i) {
+            std::array<float, 3> n;
+            normal(i, n.data());
+            mesh->vertexNormals[mesh->vertices[i]] = n;
+        }
+    }
+
+    return mesh;
+}
+
+size_t CompactMesh::memoryUsage() const
+{
+    return sizeof(CompactMesh) + positions.capacity() * sizeof(uint16_t)
+        + normals.capacity() * sizeof(int16_t) + faceData.capacity();
+}
+
+void CompactMesh::encodeNormal(const std::array<float, 3>& n, int16_t out[2])
+{
+    // project onto the octahedron, then fold the lower half over the upper one
+    float sum = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (sum == 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    float u = n[0] / sum;
+    float v = n[1] / sum;
+    if (n[2] < 0.0f) {
+        float foldedU = (1.0f - std::fabs(v)) * signNotZero(u);
+        float foldedV = (1.0f - std::fabs(u)) * signNotZero(v);
+        u = foldedU;
+        v = foldedV;
+    }
+
+    out[0] = static_cast<int16_t>(std::round(std::min(std::max(u, -1.0f), 1.0f) * 32767.0f));
+    out[1] = static_cast<int16_t>(std::round(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f));
+}
+
+void CompactMesh::decodeNormal(const int16_t in[2], float out[3])
+{
+    float u = in[0] / 32767.0f;
+    float v = in[1] / 32767.0f;
+    float z = 1.0f - std::fabs(u) - std::fabs(v);
+    if (z < 0.0f) {
+        float unfoldedU = (1.0f - std::fabs(v)) * signNotZero(u);
+        float unfoldedV = (1.0f - std::fabs(u)) * signNotZero(v);
+        u = unfoldedU;
+        v = unfoldedV;
+    }
+
+    float length = std::sqrt(u * u + v * v + z * z);
+    out[0] = u / length;
+    out[1] = v / length;
+    out[2] = z / length;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "HalfEdge.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Read-only storage for finished levels, several times smaller than the half-edge Mesh.
+// Positions are quantized to 16 bits inside the bounding box, vertex normals are octahedral
+// encoded into two 16-bit values and faces are stored as varint coded index deltas.
+// Everything is decoded on the fly, toMesh() rebuilds an editable Mesh.
+class CompactMesh
+{
+public:
+    explicit CompactMesh(const Mesh& mesh);
+
+    size_t vertexCount() const;
+    size_t faceCount() const;
+
+    void position(size_t vertexIdx, float out[3]) const;
+    bool hasNormals() const;
+    void normal(size_t vertexIdx, float out[3]) const;
+
+    // visits the faces in order with their 0-based vertex indices
+    void forEachFace(const std::function<void(const std::vector<int>& corners)>& visit) const;
+
+    // the normals are restored from the stored ones, face normals are left empty
+    Mesh* toMesh() const;
+
+    size_t memoryUsage() const;
+
+private:
+    size_t vertices;
+    size_t faces;
+
+    float minPos[3];
+    float step[3];
+    std::vector<uint16_t> positions;
+    std::vector<int16_t> normals;
+    std::vector<uint8_t> faceData;
+
+    static void encodeNormal(const std::array<float, 3>& n, int16_t out[2]);
+    static void decodeNormal(const int16_t in[2], float out[3]);
+};
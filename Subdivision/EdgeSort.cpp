@@ -0,0 +1,110 @@
+#include "EdgeSort.h"
+
+#include <algorithm>
+
+namespace {
+    const int digitBits = 11;
+    const int radix = 1 << digitBits;
+    // smaller blocks cost more in histograms than they gain in balance
+    const size_t minBlockItems = 16384;
+}
+
+int EdgeSort::blockCount(size_t count, ThreadPool* pool)
+{
+    if (!pool)
+        return 1;
+    size_t blocks = std::min(static_cast<size_t>(pool->threadCount()) * 4, count / minBlockItems);
+    return static_cast<int>(std::max<size_t>(blocks, 1));
+}
+
+int EdgeSort::bitWidth(uint64_t maxValue)
+{
+    int bits = 0;
+    while (maxValue >> bits) ++bits;
+    return bits;
+}
+
+void EdgeSort::radixSort(std::vector<uint64_t>& keys, std::vector<int>& values, int keyBits, ThreadPool* pool)
+{
+    size_t count = keys.size();
+    int blocks = blockCount(count, pool);
+    std::vector<uint64_t> keysOut(count);
+    std::vector<int> valuesOut(count);
+    // histograms[block * radix + digit], turned into the first output slot of the block for the digit
+    std::vector<size_t> histograms(static_cast<size_t>(blocks) * radix);
+
+    for (int shift = 0; shift < keyBits; shift += digitBits) {
+        forBlocks(count, blocks, pool, [&](size_t begin, size_t end, int block) {
+            size_t* histogram = &histograms[static_cast<size_t>(block) * radix];
+            std::fill(histogram, histogram + radix, 0);
+            for (size_t i = begin; i < end; ++i) histogram[(keys[i] >> shift) & (radix - 1)]++;
+        });
+
+        // digits in order, and the blocks in order inside a digit, keep the sort stable
+        size_t offset = 0;
+        for (int digit = 0; digit < radix; ++digit) {
+            for (int block = 0; block < blocks; ++block) {
+                size_t& slot = histograms[static_cast<size_t>(block) * radix + digit];
+                size_t n = slot;
+                slot = offset;
+                offset += n;
+            }
+        }
+
+        forBlocks(count, blocks, pool, [&](size_t begin, size_t end, int block) {
+            size_t* next = &histograms[static_cast<size_t>(block) * radix];
+            for (size_t i = begin; i < end; ++i) {
+                size_t slot = next[(keys[i] >> shift) & (radix - 1)]++;
+                keysOut[slot] = keys[i];
+                valuesOut[slot] = values[i];
+            }
+        });
+        keys.swap(keysOut);
+        values.swap(valuesOut);
+    }
+}
+
+void EdgeSort::pairTwins(const std::vector<int>& origins, const std::vector<int>& destinations, int vertexCount,
+    std::vector<int>& twins, ThreadPool* pool)
+{
+    size_t count = origins.size();
+    int blocks = blockCount(count, pool);
+    int vertexBits = bitWidth(vertexCount > 0 ? vertexCount - 1 : 0);
+
+    std::vector<uint64_t> keys(count);
+    std::vector<int> order(count);
+    forBlocks(count, blocks, pool, [&](size_t begin, size_t end, int) {
+        for (size_t h = begin; h < end; ++h) {
+            uint64_t a = static_cast<uint64_t>(origins[h]), b = static_cast<uint64_t>(destinations[h]);
+            keys[h] = std::min(a, b) << vertexBits | std::max(a, b);
+            order[h] = static_cast<int>(h);
+        }
+    });
+    radixSort(keys, order, vertexBits * 2, pool);
+
+    // a run of equal keys belongs to the block it starts in
+    twins.assign(count, -1);
+    forBlocks(count, blocks, pool, [&](size_t begin, size_t end, int) {
+        for (size_t first = begin; first < end; ++first) {
+            if (first > 0 && keys[first] == keys[first - 1])
+                continue;
+            size_t last = first + 1;
+            while (last < count && keys[last] == keys[first]) ++last;
+
+            // runs are one or two half-edges long unless the edge is non-manifold
+            for (size_t i = first; i < last; ++i) {
+                int he1 = order[i];
+                if (twins[he1] >= 0)
+                    continue;
+                for (size_t j = i + 1; j < last; ++j) {
+                    int he2 = order[j];
+                    if (twins[he2] < 0 && origins[he2] == destinations[he1]) {
+                        twins[he1] = he2;
+                        twins[he2] = he1;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+// Sort-based twin search for meshes too large for the hash buckets of Mesh::createTwinEdges.
+// Every half-edge gets the key (min vertex, max vertex), the keys are radix-sorted and the
+// twins are paired inside each run of equal keys, so the search reads memory in order and
+// every pass is split into blocks that run as pool tasks.
+class EdgeSort
+{
+public:
+    // number of blocks a pass over count items is cut into, 1 without a pool
+    static int blockCount(size_t count, ThreadPool* pool);
+
+    // runs body(begin, end, block) for every block, as pool tasks if a pool is given
+    template <class Body>
+    static void forBlocks(size_t count, int blocks, ThreadPool* pool, Body body);
+
+    // stable LSD sort of values by keys, only the low keyBits bits of the keys are compared
+    static void radixSort(std::vector<uint64_t>& keys, std::vector<int>& values, int keyBits, ThreadPool* pool);
+
+    // twins[h] is the half-edge from destinations[h] to origins[h] paired with h, or -1.
+    // Half-edges are paired in index order with the first free one running the other way,
+    // which matches the hash search on manifold input.
+    static void pairTwins(const std::vector<int>& origins, const std::vector<int>& destinations, int vertexCount,
+        std::vector<int>& twins, ThreadPool* pool);
+
+    // bits needed for the values 0 to maxValue
+    static int bitWidth(uint64_t maxValue);
+};
+
+template <class Body>
+void EdgeSort::forBlocks(size_t count, int blocks, ThreadPool* pool, Body body)
+{
+    if (!pool || blocks == 1) {
+        for (int block = 0; block < blocks; ++block)
+            body(count * block / blocks, count * (block + 1) / blocks, block);
+        return;
+    }
+
+    ThreadPool::TaskGroup group;
+    for (int block = 0; block < blocks; ++block) {
+        pool->submit([&body, count, blocks, block]() {
+            body(count * block / blocks, count * (block + 1) / blocks, block);
+        }, &group);
+    }
+    pool->wait(group);
+}
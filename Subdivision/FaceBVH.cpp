@@ -0,0 +1,289 @@
+#include "FaceBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+void FaceBVH::build(const Mesh& mesh, ThreadPool* pool)
+{
+    int faces = static_cast<int>(mesh.faces.size());
+    nodes.clear();
+    faceOrder.clear();
+    nodeCount = 0;
+    if (faces == 0)
+        return;
+
+    std::vector<BuildFace> buildFaces(faces);
+    for (int i = 0; i < faces; ++i) {
+        BuildFace& buildFace = buildFaces[i];
+        buildFace.face = mesh.faces[i];
+        buildFace.centroid[0] = buildFace.centroid[1] = buildFace.centroid[2] = 0.0f;
+
+        int corners = 0;
+        HalfEdge* startEdge = buildFace.face->edge;
+        HalfEdge* currEdge = startEdge;
+        do {
+            buildFace.centroid[0] += currEdge->origin->x;
+            buildFace.centroid[1] += currEdge->origin->y;
+            buildFace.centroid[2] += currEdge->origin->z;
+            corners++;
+            currEdge = currEdge->next;
+        } while (currEdge != startEdge);
+        for (int k = 0; k < 3; ++k) buildFace.centroid[k] /= corners;
+    }
+
+    // a binary tree with at least one face per leaf has fewer than 2n nodes
+    nodes.resize(2 * faces);
+    nodeCount = 1;
+
+    ThreadPool::TaskGroup group;
+    buildNode(0, buildFaces.data(), 0, faces, pool, &group);
+    if (pool) pool->wait(group);
+
+    nodes.resize(nodeCount);
+    faceOrder.resize(faces);
+    for (int i = 0; i < faces; ++i) {
+        faceOrder[i] = buildFaces[i].face;
+    }
+}
+
+void FaceBVH::buildNode(int nodeIdx, BuildFace* faces, int first, int count, ThreadPool* pool, ThreadPool::TaskGroup* group)
+{
+    Node& node = nodes[nodeIdx];
+    float centroidMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float centroidMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int k = 0; k < 3; ++k) {
+        node.minPos[k] = FLT_MAX;
+        node.maxPos[k] = -FLT_MAX;
+    }
+
+    for (int i = first; i < first + count; ++i) {
+        float faceMin[3], faceMax[3];
+        faceBounds(faces[i].face, faceMin, faceMax);
+        for (int k = 0; k < 3; ++k) {
+            node.minPos[k] = std::min(node.minPos[k], faceMin[k]);
+            node.maxPos[k] = std::max(node.maxPos[k], faceMax[k]);
+            centroidMin[k] = std::min(centroidMin[k], faces[i].centroid[k]);
+            centroidMax[k] = std::max(centroidMax[k], faces[i].centroid[k]);
+        }
+    }
+
+    if (count <= maxLeafFaces) {
+        node.first = first;
+        node.count = count;
+        return;
+    }
+
+    // median split along the longest axis of the centroids
+    int axis = 0;
+    for (int k = 1; k < 3; ++k) {
+        if (centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis])
+            axis = k;
+    }
+    int half = count / 2;
+    std::nth_element(faces + first, faces + first + half, faces + first + count,
+        [axis](const BuildFace& a, const BuildFace& b) { return a.centroid[axis] < b.centroid[axis]; });
+
+    // children are allocated after their parent, refit() relies on that
+    int left = nodeCount.fetch_add(2);
+    node.first = left;
+    node.count = 0;
+
+    if (pool && count >= parallelFaces) {
+        pool->submit([this, left, faces, first, half, pool, group]() {
+            buildNode(left, faces, first, half, pool, group);
+        }, group);
+    }
+    else {
+        buildNode(left, faces, first, half, pool, group);
+    }
+    buildNode(left + 1, faces, first + half, count - half, pool, group);
+}
+
+void FaceBVH::refit()
+{
+    for (int nodeIdx = static_cast<int>(nodes.size()) - 1; nodeIdx >= 0; --nodeIdx) {
+        Node& node = nodes[nodeIdx];
+        for (int k = 0; k < 3; ++k) {
+            node.minPos[k] = FLT_MAX;
+            node.maxPos[k] = -FLT_MAX;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                float faceMin[3], faceMax[3];
+                faceBounds(faceOrder[i], faceMin, faceMax);
+                for (int k = 0; k < 3; ++k) {
+                    node.minPos[k] = std::min(node.minPos[k], faceMin[k]);
+                    node.maxPos[k] = std::max(node.maxPos[k], faceMax[k]);
+                }
+            }
+        }
+        else {
+            for (int child = node.first; child <= node.first + 1; ++child) {
+                for (int k = 0; k < 3; ++k) {
+                    node.minPos[k] = std::min(node.minPos[k], nodes[child].minPos[k]);
+                    node.maxPos[k] = std::max(node.maxPos[k], nodes[child].maxPos[k]);
+                }
+            }
+        }
+    }
+}
+
+bool FaceBVH::pick(const float origin[3], const float direction[3], PickResult& result) const
+{
+    result = PickResult();
+    if (nodes.empty())
+        return false;
+
+    float invDirection[3];
+    for (int k = 0; k < 3; ++k) {
+        invDirection[k] = direction[k] != 0.0f ? 1.0f / direction[k] : FLT_MAX;
+    }
+
+    // slab test, returns the entry distance or FLT_MAX if the box is missed or behind a closer hit
+    auto enterBox = [&](const Node& node, float closest) {
+        float tMin = 0.0f, tMax = closest;
+        for (int k = 0; k < 3; ++k) {
+            float t0 = (node.minPos[k] - origin[k]) * invDirection[k];
+            float t1 = (node.maxPos[k] - origin[k]) * invDirection[k];
+            if (t0 > t1) std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+            if (tMin > tMax)
+                return FLT_MAX;
+        }
+        return tMin;
+    };
+
+    float closest = FLT_MAX;
+    int stack[64];
+    int stackSize = 0;
+    if (enterBox(nodes[0], closest) < FLT_MAX)
+        stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                float distance;
+                if (intersectFace(faceOrder[i], origin, direction, distance) && distance < closest) {
+                    closest = distance;
+                    result.face = faceOrder[i];
+                }
+            }
+            continue;
+        }
+
+        // visit the nearer child first, it is pushed last
+        float tLeft = enterBox(nodes[node.first], closest);
+        float tRight = enterBox(nodes[node.first + 1], closest);
+        int near = tLeft <= tRight ? node.first : node.first + 1;
+        int far = near == node.first ? node.first + 1 : node.first;
+        float tNear = std::min(tLeft, tRight), tFar = std::max(tLeft, tRight);
+        if (tFar < FLT_MAX) stack[stackSize++] = far;
+        if (tNear < FLT_MAX) stack[stackSize++] = near;
+    }
+
+    if (result.face == nullptr)
+        return false;
+
+    result.distance = closest;
+    for (int k = 0; k < 3; ++k) {
+        result.point[k] = origin[k] + direction[k] * closest;
+    }
+
+    // closest corner and closest edge of the hit face
+    float bestVertex = FLT_MAX, bestEdge = FLT_MAX;
+    HalfEdge* startEdge = result.face->edge;
+    HalfEdge* currEdge = startEdge;
+    do {
+        const Vertex* a = currEdge->origin;
+        const Vertex* b = currEdge->next->origin;
+        float ap[3] = { result.point[0] - a->x, result.point[1] - a->y, result.point[2] - a->z };
+        float ab[3] = { b->x - a->x, b->y - a->y, b->z - a->z };
+
+        float vertexDistance = ap[0] * ap[0] + ap[1] * ap[1] + ap[2] * ap[2];
+        if (vertexDistance < bestVertex) {
+            bestVertex = vertexDistance;
+            result.vertex = currEdge->origin;
+        }
+
+        float abLength = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+        float s = abLength > 0.0f ? std::min(std::max((ap[0] * ab[0] + ap[1] * ab[1] + ap[2] * ab[2]) / abLength, 0.0f), 1.0f) : 0.0f;
+        float d[3] = { ap[0] - ab[0] * s, ap[1] - ab[1] * s, ap[2] - ab[2] * s };
+        float edgeDistance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        if (edgeDistance < bestEdge) {
+            bestEdge = edgeDistance;
+            result.edge = currEdge;
+        }
+
+        currEdge = currEdge->next;
+    } while (currEdge != startEdge);
+
+    return true;
+}
+
+size_t FaceBVH::faceCount() const
+{
+    return faceOrder.size();
+}
+
+void FaceBVH::faceBounds(const Face* face, float minPos[3], float maxPos[3])
+{
+    for (int k = 0; k < 3; ++k) {
+        minPos[k] = FLT_MAX;
+        maxPos[k] = -FLT_MAX;
+    }
+
+    HalfEdge* startEdge = face->edge;
+    HalfEdge* currEdge = startEdge;
+    do {
+        const float p[3] = { currEdge->origin->x, currEdge->origin->y, currEdge->origin->z };
+        for (int k = 0; k < 3; ++k) {
+            minPos[k] = std::min(minPos[k], p[k]);
+            maxPos[k] = std::max(maxPos[k], p[k]);
+        }
+        currEdge = currEdge->next;
+    } while (currEdge != startEdge);
+}
+
+bool FaceBVH::intersectFace(const Face* face, const float origin[3], const float direction[3], float& distance)
+{
+    // Moller-Trumbore on a triangle fan, polygons from the OBJ loader are convex
+    const Vertex* v0 = face->edge->origin;
+    bool hit = false;
+    distance = FLT_MAX;
+
+    for (HalfEdge* he = face->edge->next; he->next != face->edge; he = he->next) {
+        const Vertex* v1 = he->origin;
+        const Vertex* v2 = he->next->origin;
+
+        float e1[3] = { v1->x - v0->x, v1->y - v0->y, v1->z - v0->z };
+        float e2[3] = { v2->x - v0->x, v2->y - v0->y, v2->z - v0->z };
+        float p[3] = { direction[1] * e2[2] - direction[2] * e2[1], direction[2] * e2[0] - direction[0] * e2[2], direction[0] * e2[1] - direction[1] * e2[0] };
+        float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if (std::fabs(det) < 1e-12f)
+            continue;
+
+        float invDet = 1.0f / det;
+        float s[3] = { origin[0] - v0->x, origin[1] - v0->y, origin[2] - v0->z };
+        float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+        if (u < 0.0f || u > 1.0f)
+            continue;
+
+        float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+        float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * invDet;
+        if (v < 0.0f || u + v > 1.0f)
+            continue;
+
+        float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+        if (t >= 0.0f && t < distance) {
+            distance = t;
+            hit = true;
+        }
+    }
+
+    return hit;
+}
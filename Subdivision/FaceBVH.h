@@ -0,0 +1,55 @@
+#pragma once
+#include "HalfEdge.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <vector>
+
+// Result of FaceBVH::pick, all pointers are nullptr if nothing was hit
+struct PickResult {
+    Face* face = nullptr;
+    Vertex* vertex = nullptr;     // corner of the face closest to the hit point
+    HalfEdge* edge = nullptr;     // half-edge of the face closest to the hit point
+    float distance = 0.0f;        // along the ray, in units of the ray direction
+    float point[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// Bounding volume hierarchy over the faces of a mesh for ray picking.
+// Subtrees are split at the median centroid of their longest axis and built as separate pool
+// tasks. The tree holds face pointers, so it has to be rebuilt when the faces of the mesh change;
+// if only vertex positions moved, refit() updates the bounds in place.
+class FaceBVH
+{
+public:
+    FaceBVH() = default;
+
+    void build(const Mesh& mesh, ThreadPool* pool = nullptr);
+    void refit();
+    bool pick(const float origin[3], const float direction[3], PickResult& result) const;
+
+    size_t faceCount() const;
+
+private:
+    struct Node {
+        float minPos[3];
+        float maxPos[3];
+        int first;      // first child node, or first entry of faceOrder for a leaf
+        int count;      // faces of a leaf, 0 for inner nodes
+    };
+
+    struct BuildFace {
+        Face* face;
+        float centroid[3];
+    };
+
+    static const int maxLeafFaces = 4;
+    static const int parallelFaces = 4096;
+
+    std::vector<Node> nodes;
+    std::vector<Face*> faceOrder;
+    std::atomic<int> nodeCount{ 0 };
+
+    void buildNode(int nodeIdx, BuildFace* faces, int first, int count, ThreadPool* pool, ThreadPool::TaskGroup* group);
+    static void faceBounds(const Face* face, float minPos[3], float maxPos[3]);
+    static bool intersectFace(const Face* face, const float origin[3], const float direction[3], float& distance);
+};
@@ -0,0 +1,140 @@
+#include "FrameTimer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+FrameTimer::FrameTimer(size_t historySize) : historySize(std::max<size_t>(historySize, 1))
+{
+    std::fill(queryFrames, queryFrames + queryCount, -1);
+}
+
+FrameTimer::~FrameTimer()
+{
+    if (gpuTimer)
+        glDeleteQueries(queryCount, queries);
+}
+
+void FrameTimer::initialize()
+{
+    // core since OpenGL 3.3
+    gpuTimer = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (gpuTimer)
+        glGenQueries(queryCount, queries);
+    else
+        std::cout << "No timer queries, only the CPU side of a frame is timed" << std::endl;
+}
+
+bool FrameTimer::hasGpuTimer() const
+{
+    return gpuTimer;
+}
+
+void FrameTimer::beginFrame()
+{
+    collectQueries();
+    frameStart = std::chrono::steady_clock::now();
+
+    // all queries still in flight: this frame goes without a GPU time
+    activeQuery = -1;
+    if (!gpuTimer)
+        return;
+    for (int i = 0; i < queryCount; ++i) {
+        if (queryFrames[i] < 0) {
+            activeQuery = i;
+            break;
+        }
+    }
+    if (activeQuery >= 0) {
+        queryFrames[activeQuery] = frameIndex;
+        glBeginQuery(GL_TIME_ELAPSED, queries[activeQuery]);
+    }
+}
+
+void FrameTimer::endFrame(size_t triangles, const std::string& label)
+{
+    if (activeQuery >= 0)
+        glEndQuery(GL_TIME_ELAPSED);
+    double cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+    frames.push_back({ frameIndex++, cpuMilliseconds, -1.0, triangles, label });
+    while (frames.size() > historySize) frames.pop_front();
+}
+
+void FrameTimer::collectQueries()
+{
+    for (int i = 0; i < queryCount; ++i) {
+        if (queryFrames[i] < 0)
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &nanoseconds);
+        // the frame may have left the history already
+        if (Frame* frame = findFrame(queryFrames[i]))
+            frame->gpuMilliseconds = nanoseconds / 1e6;
+        queryFrames[i] = -1;
+    }
+}
+
+FrameTimer::Frame* FrameTimer::findFrame(long long index)
+{
+    if (frames.empty() || index < frames.front().index || index > frames.back().index)
+        return nullptr;
+    return &frames[static_cast<size_t>(index - frames.front().index)];
+}
+
+double FrameTimer::averageCpuMilliseconds(size_t frameCount) const
+{
+    double sum = 0.0;
+    size_t n = 0;
+    for (auto it = frames.rbegin(); it != frames.rend() && n < frameCount; ++it, ++n) sum += it->cpuMilliseconds;
+    return n > 0 ? sum / n : -1.0;
+}
+
+double FrameTimer::averageGpuMilliseconds(size_t frameCount) const
+{
+    double sum = 0.0;
+    size_t n = 0;
+    for (auto it = frames.rbegin(); it != frames.rend() && n < frameCount; ++it) {
+        if (it->gpuMilliseconds < 0.0)
+            continue;
+        sum += it->gpuMilliseconds;
+        n++;
+    }
+    return n > 0 ? sum / n : -1.0;
+}
+
+double FrameTimer::trianglesPerSecond(size_t frameCount) const
+{
+    double milliseconds = 0.0;
+    double triangles = 0.0;
+    size_t n = 0;
+    for (auto it = frames.rbegin(); it != frames.rend() && n < frameCount; ++it, ++n) {
+        milliseconds += std::max(it->cpuMilliseconds, it->gpuMilliseconds);
+        triangles += static_cast<double>(it->triangles);
+    }
+    return milliseconds > 0.0 ? triangles / milliseconds * 1000.0 : -1.0;
+}
+
+bool FrameTimer::writeCSV(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    file << "frame,cpu_ms,gpu_ms,triangles,label\n";
+    for (const Frame& frame : frames) {
+        file << frame.index << "," << frame.cpuMilliseconds << ",";
+        if (frame.gpuMilliseconds >= 0.0)
+            file << frame.gpuMilliseconds;
+        file << "," << frame.triangles << "," << frame.label << "\n";
+    }
+    std::cout << "Wrote " << frames.size() << " frames to " << filename << std::endl;
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <chrono>
+#include <deque>
+#include <string>
+
+// Times the frames of the viewer: the CPU time spent submitting the mesh and, where timer queries
+// exist, the GPU time of the same commands. Query results arrive a few frames late and are read
+// from a small ring without waiting on the GPU. The last frames are kept for the rolling averages
+// in the nav bar and for a CSV dump.
+class FrameTimer
+{
+public:
+    explicit FrameTimer(size_t historySize = 240);
+    ~FrameTimer();
+
+    // needs a current context with the extensions loaded, without timer queries only the CPU is timed
+    void initialize();
+    bool hasGpuTimer() const;
+
+    // around the commands to be timed, label describes the frame in the CSV (level, shading)
+    void beginFrame();
+    void endFrame(size_t triangles, const std::string& label);
+
+    // over the last frames with a result, -1 if there is none yet
+    double averageCpuMilliseconds(size_t frameCount) const;
+    double averageGpuMilliseconds(size_t frameCount) const;
+    // triangles over the slower of CPU and GPU time, so it is what the viewer can sustain
+    double trianglesPerSecond(size_t frameCount) const;
+
+    // one line per kept frame: frame, cpu_ms, gpu_ms (empty if unknown), triangles, label
+    bool writeCSV(const std::string& filename) const;
+
+private:
+    struct Frame {
+        long long index;
+        double cpuMilliseconds;
+        double gpuMilliseconds;     // -1 until the query result is read
+        size_t triangles;
+        std::string label;
+    };
+
+    static const int queryCount = 4;
+
+    size_t historySize;
+    std::deque<Frame> frames;
+    long long frameIndex = 0;
+    std::chrono::steady_clock::time_point frameStart;
+
+    bool gpuTimer = false;
+    GLuint queries[queryCount] = {};
+    long long queryFrames[queryCount];     // frame each query is timing, -1 if free
+    int activeQuery = -1;
+
+    void collectQueries();
+    Frame* findFrame(long long index);
+};
@@ -1,9 +1,13 @@
 #include "HalfEdge.h"
-#include "globals.h"
+#include "EdgeSort.h"
 
-extern int vertexNameIdx = 1;
-extern int faceNameIdx = 0;
-extern int halfEdgeNameIdx = 0;
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
 
 // Based on this source: https://jerryyin.info/geometry-processing-algorithms/half-edge/
 Vertex::Vertex(float x, float y, float z, const std::string& name)
@@ -24,42 +28,55 @@ std::string Vertex::toString() const {
     return ss.str();
 }
 
+int Vertex::valence() const {
+    int n = 0;
+    for (HalfEdge* he : outgoing()) {
+        (void)he;
+        n++;
+    }
+    return n;
+}
+
+bool Vertex::isBoundary() const {
+    for (HalfEdge* he : outgoing()) {
+        if (he->isBoundaryEdge())
+            return true;
+    }
+    return false;
+}
+
 HalfEdge::HalfEdge(const std::string& name)
     : origin(nullptr), twin(nullptr), next(nullptr), prev(nullptr), incidentFace(nullptr), name(name) {}
 
 HalfEdge::HalfEdge()
-    : origin(nullptr), twin(nullptr), next(nullptr), prev(nullptr), incidentFace(nullptr)
-{
-    name = getNextName();
-}
+    : origin(nullptr), twin(nullptr), next(nullptr), prev(nullptr), incidentFace(nullptr) {}
 
-Face::Face(std::string& name) : edge(nullptr), name(name) {}
+Face::Face(const std::string& name) : edge(nullptr), name(name) {}
 
-Face::Face() : edge(nullptr)
-{
-    std::stringstream faceNameStream;
-    faceNameStream << "f" << faceNameIdx++;
-    name = faceNameStream.str();
-}
+Face::Face() : edge(nullptr) {}
 
 std::string Face::toString() const {
     std::stringstream ss;
     ss << "Face " << name << " with vertices: ";
 
-    HalfEdge* startEdge = edge;
-    HalfEdge* currEdge = startEdge;
-
-    do {
-        ss << currEdge->origin->name;
-        if (currEdge->next != startEdge) {
-            ss << " -> ";
-        }
-        currEdge = currEdge->next;
-    } while (currEdge != startEdge);
+    const char* separator = "";
+    for (Vertex* v : vertices()) {
+        ss << separator << v->name;
+        separator = " -> ";
+    }
 
     return ss.str();
 }
 
+int Face::degree() const {
+    int n = 0;
+    for (HalfEdge* he : halfEdges()) {
+        (void)he;
+        n++;
+    }
+    return n;
+}
+
 std::string HalfEdge::toString() const {
     std::stringstream ss;
     ss << "HalfEdge " << name << " from " << origin->name << std::endl;
@@ -75,9 +92,59 @@ bool HalfEdge::isBoundaryEdge()
     return incidentFace == nullptr;
 }
 
-Mesh::Mesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos) {
+MeshArrays::MeshArrays(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos)
+{
+    positions.reserve(verticesPos.size() * 3);
+    for (const auto& pos : verticesPos) positions.insert(positions.end(), pos.begin(), pos.begin() + 3);
+
+    faceOffsets.reserve(facesIndices.size() + 1);
+    for (const auto& face : facesIndices) {
+        for (int idx : face) faceIndices.push_back(idx - 1);
+        endFace();
+    }
+}
+
+void MeshArrays::addVertex(float x, float y, float z)
+{
+    positions.push_back(x);
+    positions.push_back(y);
+    positions.push_back(z);
+}
+
+void MeshArrays::endFace()
+{
+    faceOffsets.push_back(static_cast<int>(faceIndices.size()));
+}
+
+Mesh::Mesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos, float weldTolerance,
+    ThreadPool* pool)
+    : Mesh(MeshArrays(facesIndices, verticesPos), weldTolerance, pool) {}
+
+Mesh::Mesh(const MeshArrays& arrays, float weldTolerance, ThreadPool* pool) {
+    const std::vector<float>& positions = arrays.positions;
+    int vertexCount = static_cast<int>(arrays.vertexCount());
+
+    // Merge coincident vertices, vertexRemap maps file indices to mesh indices
+    std::vector<int> vertexRemap;
+    if (weldTolerance > 0.0f) {
+        int uniqueCount = 0;
+        vertexRemap = weldVertices(positions, weldTolerance, uniqueCount);
+        weldedVertexCount = vertexCount - uniqueCount;
+        std::cout << "welded " << weldedVertexCount << " coincident vertices" << std::endl;
+    }
+
+    if (pool) {
+        buildInParallel(arrays, vertexRemap, pool);
+        return;
+    }
+
     // Create vertices
-    for (const auto& pos : verticesPos) {
+    for (int posIdx = 0; posIdx < vertexCount; ++posIdx) {
+        // skip vertices merged into an earlier one
+        if (!vertexRemap.empty() && vertexRemap[posIdx] != static_cast<int>(vertices.size()))
+            continue;
+
+        const float* pos = &positions[static_cast<size_t>(posIdx) * 3];
         std::stringstream vertexNameStream;
         vertexNameStream << "v" << vertexNameIdx;
 
@@ -87,19 +154,30 @@ Mesh::Mesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<
     }
 
     // Create half-edges and faces
-    for (const auto& face : facesIndices) {
-        Face* newFace = new Face();
+    std::vector<int> face;
+    for (size_t f = 0; f < arrays.faceCount(); ++f) {
+        face.clear();
+        for (int c = arrays.faceOffsets[f]; c < arrays.faceOffsets[f + 1]; ++c) {
+            int idx = arrays.faceIndices[c];
+            face.push_back(vertexRemap.empty() ? idx : vertexRemap[idx]);
+        }
+
+        // welding can collapse a face onto an edge or a point
+        if (!vertexRemap.empty() && hasRepeatedVertex(face))
+            continue;
+
+        Face* newFace = new Face(nextFaceName());
         faces.push_back(newFace);
 
         HalfEdge* prevEdge = nullptr;
         HalfEdge* firstEdge = nullptr;
 
-        for (int i = 0; i < face.size(); ++i) {
+        for (size_t i = 0; i < face.size(); ++i) {
             std::stringstream halfEdgeNameStream;
             halfEdgeNameStream << "e" << halfEdgeNameIdx;
 
-            int currVertexIdx = face[i] - 1;
-            int nextVertexIdx = face[(i + 1) % face.size()] - 1;
+            int currVertexIdx = face[i];
+            int nextVertexIdx = face[(i + 1) % face.size()];
 
             HalfEdge* edge = new HalfEdge(halfEdgeNameStream.str());
             edge->origin = vertices[currVertexIdx];
@@ -122,29 +200,65 @@ Mesh::Mesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<
                 firstEdge->prev = edge;
             }
 
-            if (!vertices[currVertexIdx]->incidentEdge) {
-                vertices[currVertexIdx]->incidentEdge = edge;
-            }
-
             halfEdgeNameIdx++;
         }
 
         newFace->edge = firstEdge;
-        faceNameIdx++;
     }
 
     createTwinEdges();
 }
 
-void Mesh::createTwinEdges() {
+void Mesh::createTwinEdges(ThreadPool* pool) {
+    if (pool) {
+        // vertices have no index, their addresses are sorted once and searched
+        size_t vertexCount = vertices.size();
+        uintptr_t lowest = UINTPTR_MAX, highest = 0;
+        for (Vertex* v : vertices) {
+            lowest = std::min(lowest, reinterpret_cast<uintptr_t>(v));
+            highest = std::max(highest, reinterpret_cast<uintptr_t>(v));
+        }
+        // distinct vertices are at least one Vertex apart, so the keys stay distinct
+        auto addressKey = [lowest](const Vertex* v) { return static_cast<uint64_t>((reinterpret_cast<uintptr_t>(v) - lowest) / sizeof(Vertex)); };
+
+        std::vector<uint64_t> keys(vertexCount);
+        std::vector<int> order(vertexCount);
+        int blocks = EdgeSort::blockCount(vertexCount, pool);
+        EdgeSort::forBlocks(vertexCount, blocks, pool, [&](size_t begin, size_t end, int) {
+            for (size_t v = begin; v < end; ++v) {
+                keys[v] = addressKey(vertices[v]);
+                order[v] = static_cast<int>(v);
+            }
+        });
+        EdgeSort::radixSort(keys, order, EdgeSort::bitWidth(vertexCount ? addressKey(reinterpret_cast<Vertex*>(highest)) : 0), pool);
+        auto indexOf = [&](const Vertex* v) { return order[std::lower_bound(keys.begin(), keys.end(), addressKey(v)) - keys.begin()]; };
+
+        size_t halfEdgeCount = halfEdges.size();
+        std::vector<int> origins(halfEdgeCount), destinations(halfEdgeCount);
+        EdgeSort::forBlocks(halfEdgeCount, EdgeSort::blockCount(halfEdgeCount, pool), pool, [&](size_t begin, size_t end, int) {
+            for (size_t h = begin; h < end; ++h) {
+                origins[h] = indexOf(halfEdges[h]->origin);
+                destinations[h] = indexOf(halfEdges[h]->next->origin);
+            }
+        });
+        linkTwins(origins, destinations, pool);
+        return;
+    }
+
     bool foundTwin = false;
     std::vector<HalfEdge*> boundaryHalfEdges;
 
+    // bucket half-edges by origin, so a twin is searched only among the edges leaving the destination
+    std::unordered_map<Vertex*, std::vector<HalfEdge*>> outgoingHalfEdges;
+    for (auto* he : halfEdges) {
+        outgoingHalfEdges[he->origin].push_back(he);
+    }
+
     for (auto* he1 : halfEdges) {
         if (!he1->twin) {
             foundTwin = false;
-            for (auto* he2 : halfEdges) {
-                if (he1->origin == he2->next->origin && he1->next->origin == he2->origin) {
+            for (auto* he2 : outgoingHalfEdges[he1->next->origin]) {
+                if (he1->origin == he2->next->origin) {
                     he1->twin = he2;
                     he2->twin = he1;
                     foundTwin = true;
@@ -171,23 +285,274 @@ void Mesh::createTwinEdges() {
     }
 
     // Set prev and next for boundary edges
+    std::unordered_map<Vertex*, HalfEdge*> boundaryHalfEdgeByOrigin;
     for (auto* boundaryHalfEdge : boundaryHalfEdges) {
-        Vertex* origin = boundaryHalfEdge->origin;
-        Vertex* destination = boundaryHalfEdge->twin->origin;
-
-        for (auto* otherBoundaryHalfEdge : boundaryHalfEdges) {
+        boundaryHalfEdgeByOrigin[boundaryHalfEdge->origin] = boundaryHalfEdge;
+    }
 
-            if (otherBoundaryHalfEdge->origin == destination)
-                boundaryHalfEdge->next = otherBoundaryHalfEdge;
+    for (auto* boundaryHalfEdge : boundaryHalfEdges) {
+        Vertex* destination = boundaryHalfEdge->twin->origin;
 
-            if (otherBoundaryHalfEdge->twin->origin == origin)
-                boundaryHalfEdge->prev = otherBoundaryHalfEdge;
+        auto nextIt = boundaryHalfEdgeByOrigin.find(destination);
+        if (nextIt != boundaryHalfEdgeByOrigin.end()) {
+            boundaryHalfEdge->next = nextIt->second;
+            nextIt->second->prev = boundaryHalfEdge;
         }
     }
 
     for (auto* boundaryHalfEdge : boundaryHalfEdges) {
         halfEdges.push_back(boundaryHalfEdge);
     }
+
+    // boundary half-edges come last, so a boundary vertex starts its fan at the boundary
+    for (auto* he : halfEdges) {
+        he->origin->incidentEdge = he;
+    }
+}
+
+void Mesh::buildInParallel(const MeshArrays& arrays, const std::vector<int>& vertexRemap, ThreadPool* pool)
+{
+    // the first position of every welded group is kept, as in the serial loop
+    std::vector<int> keptPositions;
+    if (!vertexRemap.empty()) {
+        for (size_t posIdx = 0; posIdx < vertexRemap.size(); ++posIdx) {
+            if (vertexRemap[posIdx] == static_cast<int>(keptPositions.size()))
+                keptPositions.push_back(static_cast<int>(posIdx));
+        }
+    }
+    size_t vertexCount = vertexRemap.empty() ? arrays.vertexCount() : keptPositions.size();
+
+    vertices.resize(vertexCount);
+    EdgeSort::forBlocks(vertexCount, EdgeSort::blockCount(vertexCount, pool), pool, [&](size_t begin, size_t end, int) {
+        for (size_t v = begin; v < end; ++v) {
+            const float* pos = &arrays.positions[(vertexRemap.empty() ? v : keptPositions[v]) * 3];
+            vertices[v] = new Vertex(pos[0], pos[1], pos[2], "v" + std::to_string(vertexNameIdx + v));
+        }
+    });
+    vertexNameIdx += static_cast<int>(vertexCount);
+
+    auto remapFace = [&](size_t f, std::vector<int>& face) {
+        face.clear();
+        for (int c = arrays.faceOffsets[f]; c < arrays.faceOffsets[f + 1]; ++c) {
+            int idx = arrays.faceIndices[c];
+            face.push_back(vertexRemap.empty() ? idx : vertexRemap[idx]);
+        }
+        // welding can collapse a face onto an edge or a point
+        return vertexRemap.empty() || !hasRepeatedVertex(face);
+    };
+
+    // count the kept faces and their corners per block, the prefix sums give every block its first names
+    size_t faceCount = arrays.faceCount();
+    int blocks = EdgeSort::blockCount(faceCount, pool);
+    std::vector<size_t> blockFaces(blocks + 1, 0), blockHalfEdges(blocks + 1, 0);
+    EdgeSort::forBlocks(faceCount, blocks, pool, [&](size_t begin, size_t end, int block) {
+        std::vector<int> face;
+        for (size_t f = begin; f < end; ++f) {
+            if (remapFace(f, face)) {
+                blockFaces[block + 1]++;
+                blockHalfEdges[block + 1] += face.size();
+            }
+        }
+    });
+    for (int block = 0; block < blocks; ++block) {
+        blockFaces[block + 1] += blockFaces[block];
+        blockHalfEdges[block + 1] += blockHalfEdges[block];
+    }
+
+    faces.resize(blockFaces[blocks]);
+    halfEdges.resize(blockHalfEdges[blocks]);
+    std::vector<int> origins(halfEdges.size()), destinations(halfEdges.size());
+    EdgeSort::forBlocks(faceCount, blocks, pool, [&](size_t begin, size_t end, int block) {
+        std::vector<int> face;
+        size_t faceIdx = blockFaces[block], heIdx = blockHalfEdges[block];
+        for (size_t f = begin; f < end; ++f) {
+            if (!remapFace(f, face))
+                continue;
+
+            Face* newFace = new Face("f" + std::to_string(faceNameIdx + faceIdx));
+            faces[faceIdx++] = newFace;
+
+            size_t first = heIdx;
+            for (size_t i = 0; i < face.size(); ++i, ++heIdx) {
+                HalfEdge* edge = new HalfEdge("e" + std::to_string(halfEdgeNameIdx + heIdx));
+                edge->origin = vertices[face[i]];
+                edge->incidentFace = newFace;
+                halfEdges[heIdx] = edge;
+                origins[heIdx] = face[i];
+                destinations[heIdx] = face[(i + 1) % face.size()];
+                if (i > 0) {
+                    halfEdges[heIdx - 1]->next = edge;
+                    edge->prev = halfEdges[heIdx - 1];
+                }
+            }
+            halfEdges[heIdx - 1]->next = halfEdges[first];
+            halfEdges[first]->prev = halfEdges[heIdx - 1];
+            newFace->edge = halfEdges[first];
+        }
+    });
+    faceNameIdx += static_cast<int>(faces.size());
+    halfEdgeNameIdx += static_cast<int>(halfEdges.size());
+
+    linkTwins(origins, destinations, pool);
+}
+
+void Mesh::linkTwins(const std::vector<int>& origins, const std::vector<int>& destinations, ThreadPool* pool)
+{
+    size_t faceHalfEdgeCount = halfEdges.size();
+    std::vector<int> twins;
+    EdgeSort::pairTwins(origins, destinations, static_cast<int>(vertices.size()), twins, pool);
+
+    // boundary half-edges are numbered in the order of their face half-edges, as the serial search creates them
+    int blocks = EdgeSort::blockCount(faceHalfEdgeCount, pool);
+    std::vector<size_t> blockBoundaries(blocks + 1, 0);
+    EdgeSort::forBlocks(faceHalfEdgeCount, blocks, pool, [&](size_t begin, size_t end, int block) {
+        for (size_t h = begin; h < end; ++h) {
+            if (twins[h] >= 0)
+                halfEdges[h]->twin = halfEdges[twins[h]];
+            else
+                blockBoundaries[block + 1]++;
+        }
+    });
+    for (int block = 0; block < blocks; ++block) blockBoundaries[block + 1] += blockBoundaries[block];
+
+    size_t boundaryCount = blockBoundaries[blocks];
+    std::vector<int> boundaryFaceHalfEdges(boundaryCount);
+    halfEdges.resize(faceHalfEdgeCount + boundaryCount);
+    EdgeSort::forBlocks(faceHalfEdgeCount, blocks, pool, [&](size_t begin, size_t end, int block) {
+        size_t k = blockBoundaries[block];
+        for (size_t h = begin; h < end; ++h) {
+            if (twins[h] >= 0)
+                continue;
+            HalfEdge* boundaryEdge = new HalfEdge("e" + std::to_string(halfEdgeNameIdx + k));
+            boundaryEdge->origin = vertices[destinations[h]];
+            boundaryEdge->twin = halfEdges[h];
+            halfEdges[h]->twin = boundaryEdge;
+            halfEdges[faceHalfEdgeCount + k] = boundaryEdge;
+            boundaryFaceHalfEdges[k++] = static_cast<int>(h);
+        }
+    });
+    halfEdgeNameIdx += static_cast<int>(boundaryCount);
+
+    // the serial maps keep the last writer, which is the largest index here
+    auto atomicMax = [](std::atomic<int>& slot, int value) {
+        int current = slot.load(std::memory_order_relaxed);
+        while (current < value && !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    };
+    size_t vertexCount = vertices.size();
+    int vertexBlocks = EdgeSort::blockCount(vertexCount, pool);
+    int boundaryBlocks = EdgeSort::blockCount(boundaryCount, pool);
+    std::unique_ptr<std::atomic<int>[]> perVertex(new std::atomic<int>[vertexCount]);
+    auto clearPerVertex = [&]() {
+        EdgeSort::forBlocks(vertexCount, vertexBlocks, pool, [&](size_t begin, size_t end, int) {
+            for (size_t v = begin; v < end; ++v) perVertex[v].store(-1, std::memory_order_relaxed);
+        });
+    };
+
+    // link the boundary loops: next is the boundary half-edge leaving the destination
+    if (boundaryCount > 0) {
+        clearPerVertex();
+        EdgeSort::forBlocks(boundaryCount, boundaryBlocks, pool, [&](size_t begin, size_t end, int) {
+            for (size_t k = begin; k < end; ++k) atomicMax(perVertex[destinations[boundaryFaceHalfEdges[k]]], static_cast<int>(k));
+        });
+        std::unique_ptr<std::atomic<int>[]> prevOf(new std::atomic<int>[boundaryCount]);
+        EdgeSort::forBlocks(boundaryCount, boundaryBlocks, pool, [&](size_t begin, size_t end, int) {
+            for (size_t k = begin; k < end; ++k) prevOf[k].store(-1, std::memory_order_relaxed);
+        });
+        EdgeSort::forBlocks(boundaryCount, boundaryBlocks, pool, [&](size_t begin, size_t end, int) {
+            for (size_t k = begin; k < end; ++k) {
+                int next = perVertex[origins[boundaryFaceHalfEdges[k]]].load(std::memory_order_relaxed);
+                if (next >= 0) {
+                    halfEdges[faceHalfEdgeCount + k]->next = halfEdges[faceHalfEdgeCount + next];
+                    atomicMax(prevOf[next], static_cast<int>(k));
+                }
+            }
+        });
+        EdgeSort::forBlocks(boundaryCount, boundaryBlocks, pool, [&](size_t begin, size_t end, int) {
+            for (size_t k = begin; k < end; ++k) {
+                int prev = prevOf[k].load(std::memory_order_relaxed);
+                if (prev >= 0)
+                    halfEdges[faceHalfEdgeCount + k]->prev = halfEdges[faceHalfEdgeCount + prev];
+            }
+        });
+    }
+
+    // boundary half-edges come last, so a boundary vertex starts its fan at the boundary
+    clearPerVertex();
+    EdgeSort::forBlocks(halfEdges.size(), EdgeSort::blockCount(halfEdges.size(), pool), pool, [&](size_t begin, size_t end, int) {
+        for (size_t h = begin; h < end; ++h) {
+            int origin = h < faceHalfEdgeCount ? origins[h] : destinations[boundaryFaceHalfEdges[h - faceHalfEdgeCount]];
+            atomicMax(perVertex[origin], static_cast<int>(h));
+        }
+    });
+    EdgeSort::forBlocks(vertexCount, vertexBlocks, pool, [&](size_t begin, size_t end, int) {
+        for (size_t v = begin; v < end; ++v) {
+            int last = perVertex[v].load(std::memory_order_relaxed);
+            if (last >= 0)
+                vertices[v]->incidentEdge = halfEdges[last];
+        }
+    });
+}
+
+std::vector<int> Mesh::weldVertices(const std::vector<float>& positions, float tolerance, int& uniqueCount)
+{
+    // Hashed grid with cells of the tolerance size: a match can only be in the 27 cells around a vertex
+    auto cellKey = [](long long cx, long long cy, long long cz) {
+        return static_cast<uint64_t>(cx & 0x1fffff) << 42 | static_cast<uint64_t>(cy & 0x1fffff) << 21 | static_cast<uint64_t>(cz & 0x1fffff);
+    };
+
+    int vertexCount = static_cast<int>(positions.size() / 3);
+    std::unordered_map<uint64_t, std::vector<int>> grid;
+    grid.reserve(vertexCount);
+
+    std::vector<int> remap(vertexCount);
+    std::vector<int> representatives;
+    float toleranceSquared = tolerance * tolerance;
+
+    for (int i = 0; i < vertexCount; ++i) {
+        const float* pos = &positions[static_cast<size_t>(i) * 3];
+        long long cx = static_cast<long long>(std::floor(pos[0] / tolerance));
+        long long cy = static_cast<long long>(std::floor(pos[1] / tolerance));
+        long long cz = static_cast<long long>(std::floor(pos[2] / tolerance));
+
+        int match = -1;
+        for (long long dx = -1; dx <= 1 && match < 0; ++dx) {
+            for (long long dy = -1; dy <= 1 && match < 0; ++dy) {
+                for (long long dz = -1; dz <= 1 && match < 0; ++dz) {
+                    auto cell = grid.find(cellKey(cx + dx, cy + dy, cz + dz));
+                    if (cell == grid.end())
+                        continue;
+
+                    for (int candidate : cell->second) {
+                        const float* other = &positions[static_cast<size_t>(representatives[candidate]) * 3];
+                        float ddx = pos[0] - other[0], ddy = pos[1] - other[1], ddz = pos[2] - other[2];
+                        if (ddx * ddx + ddy * ddy + ddz * ddz <= toleranceSquared) {
+                            match = candidate;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (match < 0) {
+            match = static_cast<int>(representatives.size());
+            representatives.push_back(i);
+            grid[cellKey(cx, cy, cz)].push_back(match);
+        }
+        remap[i] = match;
+    }
+
+    uniqueCount = static_cast<int>(representatives.size());
+    return remap;
+}
+
+bool Mesh::hasRepeatedVertex(const std::vector<int>& face)
+{
+    for (size_t i = 0; i < face.size(); ++i)
+        for (size_t j = i + 1; j < face.size(); ++j)
+            if (face[i] == face[j])
+                return true;
+    return false;
 }
 
 Mesh::~Mesh() {
@@ -196,28 +561,97 @@ Mesh::~Mesh() {
     for (auto* f : faces) delete f;
 }
 
+Mesh* Mesh::clone() const {
+    std::unordered_map<const Vertex*, int> vertexIndex;
+    MeshArrays arrays;
+    arrays.positions.reserve(vertices.size() * 3);
+    for (const Vertex* v : vertices) {
+        vertexIndex[v] = static_cast<int>(vertexIndex.size());
+        arrays.addVertex(v->x, v->y, v->z);
+    }
+
+    arrays.faceOffsets.reserve(faces.size() + 1);
+    for (const Face* face : faces) {
+        HalfEdge* startEdge = face->edge;
+        HalfEdge* currEdge = startEdge;
+        do {
+            arrays.faceIndices.push_back(vertexIndex[currEdge->origin]);
+            currEdge = currEdge->next;
+        } while (currEdge != startEdge);
+        arrays.endFace();
+    }
+
+    Mesh* copy = new Mesh(arrays);
+    copy->channels = channels;
+    return copy;
+}
+
+AttributeChannel* Mesh::findChannel(const std::string& name) {
+    for (AttributeChannel& channel : channels) {
+        if (channel.name == name)
+            return &channel;
+    }
+    return nullptr;
+}
+
+size_t Mesh::memoryUsage() const {
+    // names longer than the small string buffer live on the heap
+    auto nameBytes = [](const std::string& name) {
+        return name.capacity() > std::string().capacity() ? name.capacity() + 1 : 0;
+    };
+
+    size_t bytes = sizeof(Mesh);
+    bytes += vertices.capacity() * sizeof(Vertex*) + halfEdges.capacity() * sizeof(HalfEdge*) + faces.capacity() * sizeof(Face*);
+    for (const Vertex* v : vertices) bytes += sizeof(Vertex) + nameBytes(v->name);
+    for (const HalfEdge* he : halfEdges) bytes += sizeof(HalfEdge) + nameBytes(he->name);
+    for (const Face* f : faces) bytes += sizeof(Face) + nameBytes(f->name);
+
+    // hash map nodes hold the key, the value and a next pointer, plus one bucket pointer each
+    bytes += vertexNormals.size() * (sizeof(std::pair<Vertex* const, std::array<float, 3>>) + sizeof(void*))
+        + vertexNormals.bucket_count() * sizeof(void*);
+    bytes += faceNormals.size() * (sizeof(std::pair<Face* const, std::array<float, 3>>) + sizeof(void*))
+        + faceNormals.bucket_count() * sizeof(void*);
+    for (const AttributeChannel& channel : channels) bytes += sizeof(AttributeChannel) + channel.values.capacity() * sizeof(float);
+
+    return bytes;
+}
+
 std::string Mesh::toString() const {
     std::stringstream ss;
 
     ss << "Vertices:\n";
-    for (int i = 0; i < vertices.size(); ++i) {
+    for (size_t i = 0; i < vertices.size(); ++i) {
         ss << vertices[i]->toString() << std::endl;
     }
 
     ss << "\nHalfEdges:\n";
-    for (int i = 0; i < halfEdges.size(); ++i) {
+    for (size_t i = 0; i < halfEdges.size(); ++i) {
         ss << halfEdges[i]->toString() << std::endl;
     }
 
     ss << "\nFaces:\n";
-    for (int i = 0; i < faces.size(); ++i) {
+    for (size_t i = 0; i < faces.size(); ++i) {
         ss << faces[i]->toString() << std::endl;
     }
 
     return ss.str();
 }
 
-std::string HalfEdge::getNextName()
+std::string Mesh::nextVertexName()
+{
+    std::stringstream vertexNameStream;
+    vertexNameStream << "v" << vertexNameIdx++;
+    return vertexNameStream.str();
+}
+
+std::string Mesh::nextFaceName()
+{
+    std::stringstream faceNameStream;
+    faceNameStream << "f" << faceNameIdx++;
+    return faceNameStream.str();
+}
+
+std::string Mesh::nextHalfEdgeName()
 {
     std::stringstream halfEdgeNameStream;
     halfEdgeNameStream << "e" << halfEdgeNameIdx++;
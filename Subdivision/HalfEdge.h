@@ -5,10 +5,62 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <array>
+#include <unordered_map>
 
 // Forward declarations for pointers
+class Vertex;
 class HalfEdge;
 class Face;
+class ThreadPool;
+
+// Circulators over half-edge loops, usable with range-for without allocating.
+// Step moves to the next half-edge of the loop, Project turns a half-edge into the visited value.
+// The loop ends when it is back at its first half-edge or reaches a missing link.
+template <class Step, class Project>
+class HalfEdgeIterator {
+public:
+    HalfEdgeIterator(HalfEdge* current, HalfEdge* start) : current(current), start(start) {}
+
+    auto operator*() const -> decltype(Project::get(static_cast<HalfEdge*>(nullptr))) { return Project::get(current); }
+    bool operator!=(const HalfEdgeIterator& other) const { return current != other.current; }
+    HalfEdgeIterator& operator++()
+    {
+        current = Step::step(current);
+        if (current == start) current = nullptr;
+        return *this;
+    }
+
+private:
+    HalfEdge* current;
+    HalfEdge* start;
+};
+
+template <class Step, class Project>
+class HalfEdgeRange {
+public:
+    explicit HalfEdgeRange(HalfEdge* start) : start(start) {}
+
+    HalfEdgeIterator<Step, Project> begin() const { return HalfEdgeIterator<Step, Project>(start, start); }
+    HalfEdgeIterator<Step, Project> end() const { return HalfEdgeIterator<Step, Project>(nullptr, start); }
+
+private:
+    HalfEdge* start;
+};
+
+// he->next, around a face or along a boundary loop
+struct NextInLoop { static HalfEdge* step(HalfEdge* he); };
+// he->twin->next, the outgoing half-edges of he->origin; boundary half-edges close the fan
+struct NextAroundOrigin { static HalfEdge* step(HalfEdge* he); };
+
+struct AsHalfEdge { static HalfEdge* get(HalfEdge* he) { return he; } };
+struct AsOrigin { static Vertex* get(HalfEdge* he); };
+struct AsDestination { static Vertex* get(HalfEdge* he); };
+
+typedef HalfEdgeRange<NextInLoop, AsHalfEdge> LoopHalfEdges;
+typedef HalfEdgeRange<NextInLoop, AsOrigin> LoopVertices;
+typedef HalfEdgeRange<NextAroundOrigin, AsHalfEdge> OutgoingHalfEdges;
+typedef HalfEdgeRange<NextAroundOrigin, AsDestination> OneRing;
 
 class Vertex {
 public:
@@ -19,6 +71,12 @@ public:
     Vertex(float x, float y, float z, const std::string& name = "");
     Vertex(Vertex* v);
     std::string toString() const;
+
+    // boundary half-edges included, so a boundary vertex visits each neighbor once
+    OutgoingHalfEdges outgoing() const { return OutgoingHalfEdges(incidentEdge); }
+    OneRing oneRing() const { return OneRing(incidentEdge); }
+    int valence() const;
+    bool isBoundary() const;
 };
 
 class HalfEdge {
@@ -35,7 +93,9 @@ public:
 
     std::string toString() const;
     bool isBoundaryEdge();
-    std::string getNextName();
+
+    // the loop this half-edge belongs to: a face, or a boundary loop for boundary half-edges
+    LoopHalfEdges loop() { return LoopHalfEdges(this); }
 };
 
 class Face {
@@ -43,9 +103,44 @@ public:
     HalfEdge* edge;
     std::string name;
 
-    Face(std::string& name);
+    Face(const std::string& name);
     Face();
     std::string toString() const;
+
+    LoopHalfEdges halfEdges() const { return LoopHalfEdges(edge); }
+    LoopVertices vertices() const { return LoopVertices(edge); }
+    int degree() const;
+};
+
+// Extra per-element data carried through subdivision, such as UVs, colors or weights.
+// Per-vertex channels hold width floats per vertex in the order of Mesh::vertices. Face-varying
+// channels hold width floats per face corner, faces in order and corners from Face::edge on,
+// so a vertex can have different values on both sides of a seam.
+struct AttributeChannel {
+    std::string name;
+    int width = 1;
+    bool faceVarying = false;
+    std::vector<float> values;
+};
+
+// Positions and polygons in flat arrays, so a mesh is handed over without an allocation per
+// element: xyz per vertex, and face f has the 0-based corners faceIndices[faceOffsets[f]] up to
+// faceIndices[faceOffsets[f + 1]].
+struct MeshArrays {
+    std::vector<float> positions;
+    std::vector<int> faceOffsets = { 0 };
+    std::vector<int> faceIndices;
+
+    MeshArrays() = default;
+    // from the nested form with 1-based OBJ indices
+    MeshArrays(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos);
+
+    size_t vertexCount() const { return positions.size() / 3; }
+    size_t faceCount() const { return faceOffsets.size() - 1; }
+
+    void addVertex(float x, float y, float z);
+    // closes the face made of the corners pushed to faceIndices since the last one
+    void endFace();
 };
 
 class Mesh {
@@ -54,11 +149,72 @@ public:
     std::vector<HalfEdge*> halfEdges;
     std::vector<Face*> faces;
 
-    Mesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos);
+    // element name counters, kept per mesh so meshes can be built and subdivided on different threads
+    int vertexNameIdx = 1;
+    int faceNameIdx = 0;
+    int halfEdgeNameIdx = 0;
+
+    // normals for shading, filled by Shadings::calculateNormals
+    std::unordered_map<Vertex*, std::array<float, 3>> vertexNormals;
+    std::unordered_map<Face*, std::array<float, 3>> faceNormals;
+
+    std::vector<AttributeChannel> channels;
+    // null if there is no channel with this name
+    AttributeChannel* findChannel(const std::string& name);
+
+    // vertices merged by the weld of the constructor
+    int weldedVertexCount = 0;
+
+    // vertices closer than weldTolerance are merged before the topology is built (disabled if <= 0).
+    // With a pool the elements are created and the twins found by sorting in parallel passes,
+    // the names and links are the same as without one. The arrays are only read.
+    explicit Mesh(const MeshArrays& arrays, float weldTolerance = 0.0f, ThreadPool* pool = nullptr);
+    // nested OBJ form with 1-based indices, flattened first
+    Mesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos, float weldTolerance = 0.0f,
+        ThreadPool* pool = nullptr);
     ~Mesh();
 
+    // deep copy of the positions, faces and channels, normals are not copied
+    Mesh* clone() const;
+
+    // approximate heap size of the mesh in bytes, elements, names and normals included
+    size_t memoryUsage() const;
+
     std::string toString() const;
-    void createTwinEdges();
+    // pairs the half-edges of the faces and closes the holes with boundary half-edges,
+    // hashed by origin without a pool and sorted by edge with one
+    void createTwinEdges(ThreadPool* pool = nullptr);
+
+    std::string nextVertexName();
+    std::string nextFaceName();
+    std::string nextHalfEdgeName();
+
+private:
+    static std::vector<int> weldVertices(const std::vector<float>& positions, float tolerance, int& uniqueCount);
+    static bool hasRepeatedVertex(const std::vector<int>& face);
+
+    void buildInParallel(const MeshArrays& arrays, const std::vector<int>& vertexRemap, ThreadPool* pool);
+    // the parallel createTwinEdges on halfEdges holding only face half-edges, given by their vertex indices
+    void linkTwins(const std::vector<int>& origins, const std::vector<int>& destinations, ThreadPool* pool);
 };
 
+// The pointer mesh behind the accessors of TriangleMesh, so rules written against those run on both
+struct HalfEdgeTopology {
+    typedef HalfEdge* HalfEdgeHandle;
+    typedef Vertex* VertexHandle;
+
+    static Vertex* origin(HalfEdge* he) { return he->origin; }
+    static HalfEdge* twin(HalfEdge* he) { return he->twin; }
+    static HalfEdge* next(HalfEdge* he) { return he->next; }
+    static bool isBoundary(HalfEdge* he) { return he->isBoundaryEdge(); }
+    static OneRing oneRing(Vertex* v) { return v->oneRing(); }
+    static int valence(Vertex* v) { return v->valence(); }
+    static const std::string& vertexName(Vertex* v) { return v->name; }
+};
+
+inline HalfEdge* NextInLoop::step(HalfEdge* he) { return he->next; }
+inline HalfEdge* NextAroundOrigin::step(HalfEdge* he) { return he->twin ? he->twin->next : nullptr; }
+inline Vertex* AsOrigin::get(HalfEdge* he) { return he->origin; }
+inline Vertex* AsDestination::get(HalfEdge* he) { return he->twin->origin; }
+
 #endif // HALF_EDGE_H
\ No newline at end of file
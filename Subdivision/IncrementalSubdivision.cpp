@@ -0,0 +1,184 @@
+#include "IncrementalSubdivision.h"
+#include "Shadings.h"
+
+IncrementalSubdivision::IncrementalSubdivision(TriangleSubdivison& scheme, bool moveVertices)
+    : scheme(scheme), moveVertices(moveVertices) {}
+
+bool IncrementalSubdivision::build(const TriangleMesh& base, int levelCount)
+{
+    levels.assign(1, base);
+    stencils.assign(levelCount, StencilTable());
+    mesh.reset();
+    dirtyVertices.clear();
+
+    scheme.setLevel(0);
+    for (int level = 0; level < levelCount; ++level) {
+        levels.push_back(levels.back());
+        if (!scheme.subdivideWithStencils(levels.back(), moveVertices, stencils[level])) {
+            levels.clear();
+            stencils.clear();
+            return false;
+        }
+    }
+
+    mesh.reset(levels.back().toMesh());
+    Shadings::calculateNormals(mesh.get());
+    marked.assign(levels.back().vertexCount(), 0);
+    markedFaces.assign(levels.back().faceCount(), 0);
+
+    faceNormalSlots.resize(mesh->faces.size());
+    for (size_t f = 0; f < mesh->faces.size(); ++f) faceNormalSlots[f] = &mesh->faceNormals[mesh->faces[f]];
+    vertexNormalSlots.resize(mesh->vertices.size());
+    for (size_t v = 0; v < mesh->vertices.size(); ++v) vertexNormalSlots[v] = &mesh->vertexNormals[mesh->vertices[v]];
+    return true;
+}
+
+size_t IncrementalSubdivision::moveControlVertices(const std::vector<int>& vertices, const std::vector<float>& positions)
+{
+    if (levels.empty())
+        return 0;
+
+    std::vector<int> current;
+    std::vector<float>& basePositions = levels[0].positions;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        int v = vertices[i];
+        std::copy(positions.begin() + i * 3, positions.begin() + i * 3 + 3, basePositions.begin() + static_cast<size_t>(v) * 3);
+        if (!marked[v]) {
+            marked[v] = 1;
+            current.push_back(v);
+        }
+    }
+    for (int v : current) marked[v] = 0;
+
+    size_t recomputed = 0;
+    std::vector<int> next;
+    for (size_t level = 0; level < stencils.size(); ++level) {
+        const StencilTable& table = stencils[level];
+        const TriangleMesh& coarse = levels[level];
+        TriangleMesh& fine = levels[level + 1];
+
+        // a vertex keeps its index on the next level, the others are found through the rows reading it
+        next.clear();
+        auto mark = [&](int v) {
+            if (!marked[v]) {
+                marked[v] = 1;
+                next.push_back(v);
+            }
+        };
+        for (int v : current) {
+            mark(v);
+            for (const int* d = table.dependentsBegin(v); d != table.dependentsEnd(v); ++d) mark(*d);
+        }
+
+        for (int v : next) {
+            marked[v] = 0;
+            int row = table.rowOf(v);
+            float* out = &fine.positions[static_cast<size_t>(v) * 3];
+            if (row >= 0)
+                table.applyRow(row, coarse.positions.data(), out);
+            else
+                std::copy(coarse.positions.begin() + v * 3, coarse.positions.begin() + v * 3 + 3, out);
+        }
+        recomputed += next.size();
+        current.swap(next);
+    }
+    dirtyVertices = current;
+
+    // the Mesh was built from the finest level, its vertices and faces have the same indices
+    const std::vector<float>& finePositions = levels.back().positions;
+    for (int v : dirtyVertices) {
+        Vertex* vertex = mesh->vertices[v];
+        vertex->x = finePositions[v * 3];
+        vertex->y = finePositions[v * 3 + 1];
+        vertex->z = finePositions[v * 3 + 2];
+    }
+    updateNormals();
+    return recomputed;
+}
+
+template <class Visit>
+void IncrementalSubdivision::forEachFaceAround(const TriangleMesh& level, int v, Visit visit) const
+{
+    int start = level.outgoing(v);
+    for (int he = start; he >= 0;) {
+        if (!level.isBoundary(he))
+            visit(he / 3);
+        he = level.next(level.twin(he));
+        if (he == start)
+            break;
+    }
+}
+
+void IncrementalSubdivision::updateNormals()
+{
+    const TriangleMesh& finest = levels.back();
+    const float* positions = finest.positions.data();
+
+    std::vector<int> faces;
+    for (int v : dirtyVertices) {
+        forEachFaceAround(finest, v, [&](int f) {
+            if (!markedFaces[f]) {
+                markedFaces[f] = 1;
+                faces.push_back(f);
+            }
+        });
+    }
+
+    // a corner of a changed face can lie outside the dirty vertices, its normal averages that face too
+    std::vector<int> corners;
+    for (int f : faces) {
+        markedFaces[f] = 0;
+        int c[3] = { finest.origin(f * 3), finest.origin(f * 3 + 1), finest.origin(f * 3 + 2) };
+        *faceNormalSlots[f] = Shadings::triangleNormal(positions + c[0] * 3, positions + c[1] * 3, positions + c[2] * 3);
+        for (int v : c) {
+            if (!marked[v]) {
+                marked[v] = 1;
+                corners.push_back(v);
+            }
+        }
+    }
+
+    for (int v : corners) {
+        marked[v] = 0;
+        std::array<float, 3> normal = { 0.0f, 0.0f, 0.0f };
+        forEachFaceAround(finest, v, [&](int f) {
+            const std::array<float, 3>& faceNormal = *faceNormalSlots[f];
+            normal[0] += faceNormal[0];
+            normal[1] += faceNormal[1];
+            normal[2] += faceNormal[2];
+        });
+        Shadings::normalize(normal);
+        *vertexNormalSlots[v] = normal;
+    }
+}
+
+int IncrementalSubdivision::levelCount() const
+{
+    return static_cast<int>(levels.size());
+}
+
+const TriangleMesh& IncrementalSubdivision::getLevel(int level) const
+{
+    return levels[level];
+}
+
+Mesh* IncrementalSubdivision::getMesh() const
+{
+    return mesh.get();
+}
+
+const std::vector<int>& IncrementalSubdivision::getDirtyVertices() const
+{
+    return dirtyVertices;
+}
+
+size_t IncrementalSubdivision::memoryUsage() const
+{
+    size_t bytes = sizeof(IncrementalSubdivision) + marked.capacity() + markedFaces.capacity() + dirtyVertices.capacity() * sizeof(int)
+        + (faceNormalSlots.capacity() + vertexNormalSlots.capacity()) * sizeof(void*);
+    for (const TriangleMesh& level : levels) bytes += level.memoryUsage();
+    for (const StencilTable& table : stencils) bytes += table.memoryUsage();
+    if (mesh)
+        bytes += mesh->memoryUsage();
+    return bytes;
+}
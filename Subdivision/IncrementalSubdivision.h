@@ -0,0 +1,58 @@
+#pragma once
+#include "SubdivisionStencil.h"
+#include "TriangleMesh.h"
+#include "TriangleSubdivison.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+// Keeps every level of a subdivided cage together with the stencils that built it, so moving a
+// few control vertices recomputes only the vertices that depend on them. The dirty vertices of a
+// level are the rows reading a dirty vertex of the coarser one, a few rings around the edit at any
+// depth, and they are placed by the same sums as a full rebuild, so the bits agree with it.
+// The finest level is also kept as a Mesh for drawing. Its positions and the normals of the faces
+// around the dirty vertices and of their corners are updated in place, found by index on the
+// finest level and written through pointers into the normal maps, so no element is hashed.
+class IncrementalSubdivision
+{
+public:
+    IncrementalSubdivision(TriangleSubdivison& scheme, bool moveVertices);
+
+    // false if the scheme refused or cancelled a level
+    bool build(const TriangleMesh& base, int levels);
+
+    // moves control vertices to the xyz triples in positions and updates every level,
+    // returns the number of vertices recomputed on all levels together
+    size_t moveControlVertices(const std::vector<int>& vertices, const std::vector<float>& positions);
+
+    // the base mesh is level 0
+    int levelCount() const;
+    const TriangleMesh& getLevel(int level) const;
+    // the finest level with its normals, valid until the next build
+    Mesh* getMesh() const;
+    // vertices of the finest level changed by the last move
+    const std::vector<int>& getDirtyVertices() const;
+
+    size_t memoryUsage() const;
+
+private:
+    TriangleSubdivison& scheme;
+    bool moveVertices;
+
+    std::vector<TriangleMesh> levels;
+    std::vector<StencilTable> stencils;     // stencils[l] builds level l + 1
+    std::unique_ptr<Mesh> mesh;
+    std::vector<int> dirtyVertices;
+    // one flag per vertex and face of the finest level, cleared again after every use
+    std::vector<char> marked;
+    std::vector<char> markedFaces;
+    // the values of Mesh::faceNormals and Mesh::vertexNormals by index, map nodes do not move
+    std::vector<std::array<float, 3>*> faceNormalSlots;
+    std::vector<std::array<float, 3>*> vertexNormalSlots;
+
+    void updateNormals();
+    // the faces around v in the order of Vertex::outgoing, without the boundary
+    template <class Visit>
+    void forEachFaceAround(const TriangleMesh& level, int v, Visit visit) const;
+};
@@ -0,0 +1,169 @@
+#include "LevelCache.h"
+
+LevelCache::LevelCache(Mesh* base, size_t budgetBytes, bool compressLevels)
+    : base(base), budgetBytes(budgetBytes), compressLevels(compressLevels), usedBytes(base->memoryUsage()) {}
+
+LevelCache::~LevelCache()
+{
+    for (auto& level : levels) {
+        delete level.second.mesh;
+        delete level.second.compact;
+    }
+    delete base;
+}
+
+Mesh* LevelCache::find(const std::string& scheme, int level)
+{
+    if (level == 0)
+        return base;
+
+    Key key(scheme, level);
+    auto it = levels.find(key);
+    if (it == levels.end())
+        return nullptr;
+
+    if (it->second.mesh == nullptr) {
+        // the decoded level becomes the protected one, it is about to be used
+        expand(it->second);
+        lastInserted = key;
+        evict();
+    }
+    return it->second.mesh;
+}
+
+int LevelCache::nearestCoarser(const std::string& scheme, int level, Mesh*& mesh)
+{
+    // keys of one scheme are sorted by level, so the last one not above level is the closest.
+    // Compressed levels are skipped, their quantization error would carry into every finer level.
+    auto it = levels.upper_bound(Key(scheme, level));
+    while (it != levels.begin()) {
+        --it;
+        if (it->first.first != scheme)
+            break;
+        if (it->second.mesh != nullptr) {
+            mesh = it->second.mesh;
+            return it->first.second;
+        }
+    }
+
+    mesh = base;
+    return 0;
+}
+
+void LevelCache::insert(const std::string& scheme, int level, Mesh* mesh)
+{
+    if (level <= 0 || mesh == base)
+        return;
+
+    Key key(scheme, level);
+    auto it = levels.find(key);
+    if (it != levels.end()) {
+        if (it->second.mesh == mesh)
+            return;
+        usedBytes -= it->second.bytes;
+        delete it->second.mesh;
+        delete it->second.compact;
+        levels.erase(it);
+    }
+
+    Entry entry = { mesh, nullptr, mesh->memoryUsage() };
+    levels[key] = entry;
+    usedBytes += entry.bytes;
+
+    lastInserted = key;
+    evict();
+}
+
+Mesh* LevelCache::get(const std::string& scheme, int level, TriangleSubdivison& subdivision, bool moveVertices)
+{
+    Mesh* mesh = find(scheme, level);
+    if (mesh != nullptr)
+        return mesh;
+
+    Mesh* coarser = nullptr;
+    int coarserLevel = nearestCoarser(scheme, level, coarser);
+    std::cout << "level " << level << " of " << scheme << " not cached, subdividing from level " << coarserLevel << std::endl;
+
+    mesh = coarser->clone();
+    subdivision.setLevel(coarserLevel);
+    for (int l = coarserLevel; l < level; ++l) {
+        // a refused or cancelled level leaves the mesh coarser than its key
+        if (!subdivision.subdivide(mesh, moveVertices)) {
+            delete mesh;
+            return nullptr;
+        }
+    }
+
+    insert(scheme, level, mesh);
+    return mesh;
+}
+
+void LevelCache::setBudget(size_t budgetBytes)
+{
+    this->budgetBytes = budgetBytes;
+    evict();
+}
+
+size_t LevelCache::getBudget() const
+{
+    return budgetBytes;
+}
+
+size_t LevelCache::memoryUsage() const
+{
+    return usedBytes;
+}
+
+Mesh* LevelCache::expand(Entry& entry)
+{
+    if (entry.mesh == nullptr) {
+        entry.mesh = entry.compact->toMesh();
+        delete entry.compact;
+        entry.compact = nullptr;
+
+        usedBytes -= entry.bytes;
+        entry.bytes = entry.mesh->memoryUsage();
+        usedBytes += entry.bytes;
+    }
+    return entry.mesh;
+}
+
+void LevelCache::evict()
+{
+    while (usedBytes > budgetBytes) {
+        // finest level of any scheme, those are the most expensive to keep and the cheapest to lose.
+        // Full meshes are packed before anything is deleted.
+        auto finest = levels.end();
+        bool packing = false;
+        for (auto it = levels.begin(); it != levels.end(); ++it) {
+            if (it->first == lastInserted)
+                continue;
+            bool packable = compressLevels && it->second.mesh != nullptr;
+            if (finest == levels.end() || (packable && !packing)
+                || (packable == packing && it->first.second > finest->first.second)) {
+                finest = it;
+                packing = packable;
+            }
+        }
+        if (finest == levels.end())
+            return;
+
+        Entry& entry = finest->second;
+        usedBytes -= entry.bytes;
+        if (packing) {
+            entry.compact = new CompactMesh(*entry.mesh);
+            delete entry.mesh;
+            entry.mesh = nullptr;
+            entry.bytes = entry.compact->memoryUsage();
+            usedBytes += entry.bytes;
+            std::cout << "compressed level " << finest->first.second << " of " << finest->first.first
+                << " to " << entry.bytes / 1024 << " KB" << std::endl;
+        }
+        else {
+            std::cout << "evicting level " << finest->first.second << " of " << finest->first.first
+                << " (" << entry.bytes / 1024 << " KB)" << std::endl;
+            delete entry.compact;
+            levels.erase(finest);
+        }
+    }
+}
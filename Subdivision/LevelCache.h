@@ -0,0 +1,61 @@
+#pragma once
+#include "CompactMesh.h"
+#include "TriangleSubdivison.h"
+
+#include <map>
+#include <string>
+#include <utility>
+
+// Keeps the levels computed by each scheme so the viewer can switch between them without
+// recomputing. Level 0 is the base mesh and is shared by all schemes. The cache owns its meshes;
+// once they use more than the budget, the finest levels are first packed into CompactMeshes
+// (if compressLevels is set) and then deleted. The base mesh and the most recently inserted or
+// found level are never touched.
+class LevelCache
+{
+public:
+    LevelCache(Mesh* base, size_t budgetBytes = size_t(512) << 20, bool compressLevels = true);
+    ~LevelCache();
+
+    LevelCache(const LevelCache&) = delete;
+    LevelCache& operator=(const LevelCache&) = delete;
+
+    // nullptr if the level is not cached, a compressed level is decoded first
+    Mesh* find(const std::string& scheme, int level);
+
+    // finest uncompressed level of the scheme at or below level, the base mesh if there is none.
+    // Compressed levels are lossy and are not used as a seed. The mesh stays valid until the next
+    // insert or find.
+    int nearestCoarser(const std::string& scheme, int level, Mesh*& mesh);
+
+    // takes ownership of mesh and evicts other levels if the budget is exceeded
+    void insert(const std::string& scheme, int level, Mesh* mesh);
+
+    // returns the cached level, or computes it from the nearest coarser one on this thread;
+    // nullptr if the subdivision was cancelled or refused by its memory budget
+    Mesh* get(const std::string& scheme, int level, TriangleSubdivison& subdivision, bool moveVertices);
+
+    void setBudget(size_t budgetBytes);
+    size_t getBudget() const;
+    size_t memoryUsage() const;
+
+private:
+    typedef std::pair<std::string, int> Key;
+
+    // exactly one of mesh and compact is set
+    struct Entry {
+        Mesh* mesh;
+        CompactMesh* compact;
+        size_t bytes;
+    };
+
+    Mesh* base;
+    size_t budgetBytes;
+    bool compressLevels;
+    size_t usedBytes;
+    std::map<Key, Entry> levels;
+    Key lastInserted;
+
+    Mesh* expand(Entry& entry);
+    void evict();
+};
@@ -0,0 +1,257 @@
+#include "LocalSocket.h"
+
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    typedef SOCKET NativeSocket;
+    const NativeSocket invalidSocket = INVALID_SOCKET;
+
+    bool startWinsock()
+    {
+        static bool started = [] {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return started;
+    }
+
+    void closeSocket(NativeSocket s) { closesocket(s); }
+    void removeFile(const std::string& path) { DeleteFileA(path.c_str()); }
+#else
+    typedef int NativeSocket;
+    const NativeSocket invalidSocket = -1;
+
+    bool startWinsock() { return true; }
+    void closeSocket(NativeSocket s) { ::close(s); }
+    void removeFile(const std::string& path) { ::unlink(path.c_str()); }
+#endif
+
+    bool makeAddress(const std::string& path, sockaddr_un& address)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    NativeSocket native(intptr_t handle) { return static_cast<NativeSocket>(handle); }
+}
+
+LocalSocket::~LocalSocket()
+{
+    close();
+}
+
+LocalSocket::LocalSocket(LocalSocket&& other) : handle(other.handle)
+{
+    other.handle = -1;
+}
+
+LocalSocket& LocalSocket::operator=(LocalSocket&& other)
+{
+    if (this != &other) {
+        close();
+        std::swap(handle, other.handle);
+    }
+    return *this;
+}
+
+bool LocalSocket::listen(const std::string& path)
+{
+    close();
+    sockaddr_un address;
+    if (!startWinsock() || !makeAddress(path, address))
+        return false;
+
+    NativeSocket s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == invalidSocket)
+        return false;
+
+    removeFile(path);
+    if (::bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(s, 16) != 0) {
+        closeSocket(s);
+        return false;
+    }
+    handle = static_cast<intptr_t>(s);
+    return true;
+}
+
+LocalSocket LocalSocket::accept()
+{
+    if (!isValid())
+        return LocalSocket();
+    NativeSocket s = ::accept(native(handle), nullptr, nullptr);
+    return LocalSocket(s == invalidSocket ? -1 : static_cast<intptr_t>(s));
+}
+
+bool LocalSocket::connect(const std::string& path)
+{
+    close();
+    sockaddr_un address;
+    if (!startWinsock() || !makeAddress(path, address))
+        return false;
+
+    NativeSocket s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == invalidSocket)
+        return false;
+    if (::connect(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        closeSocket(s);
+        return false;
+    }
+    handle = static_cast<intptr_t>(s);
+    return true;
+}
+
+bool LocalSocket::isValid() const
+{
+    return handle != -1;
+}
+
+void LocalSocket::close()
+{
+    if (isValid()) {
+        closeSocket(native(handle));
+        handle = -1;
+    }
+}
+
+bool LocalSocket::readAll(void* data, size_t bytes)
+{
+    char* out = static_cast<char*>(data);
+    while (bytes > 0) {
+        int chunk = static_cast<int>(bytes < (1u << 30) ? bytes : (1u << 30));
+        auto received = ::recv(native(handle), out, chunk, 0);
+        if (received <= 0)
+            return false;
+        out += received;
+        bytes -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+bool LocalSocket::writeAll(const void* data, size_t bytes)
+{
+#ifdef MSG_NOSIGNAL
+    // a client that went away must not kill the daemon with SIGPIPE
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    const char* in = static_cast<const char*>(data);
+    while (bytes > 0) {
+        int chunk = static_cast<int>(bytes < (1u << 30) ? bytes : (1u << 30));
+        auto sent = ::send(native(handle), in, chunk, flags);
+        if (sent <= 0)
+            return false;
+        in += sent;
+        bytes -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+    : view(other.view), length(other.length), file(other.file), mapping(other.mapping)
+{
+    other.view = nullptr;
+    other.length = 0;
+    other.file = other.mapping = nullptr;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+    if (this != &other) {
+        close();
+        std::swap(view, other.view);
+        std::swap(length, other.length);
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    // shared delete access lets the owner remove the file while it is mapped here
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(f, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(f);
+        return false;
+    }
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m == nullptr) {
+        CloseHandle(f);
+        return false;
+    }
+    const void* v = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (v == nullptr) {
+        CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    file = f;
+    mapping = m;
+    view = static_cast<const uint8_t*>(v);
+    length = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* v = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file alive, the descriptor is not needed anymore
+    ::close(fd);
+    if (v == MAP_FAILED)
+        return false;
+    view = static_cast<const uint8_t*>(v);
+    length = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (view == nullptr)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+    CloseHandle(static_cast<HANDLE>(mapping));
+    CloseHandle(static_cast<HANDLE>(file));
+#else
+    ::munmap(const_cast<uint8_t*>(view), length);
+#endif
+    view = nullptr;
+    length = 0;
+    file = mapping = nullptr;
+}
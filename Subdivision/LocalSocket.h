@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Stream socket bound to a filesystem path (AF_UNIX), for tools talking to a daemon on the same
+// machine. POSIX sockets, or Winsock on Windows 10 and later. Handles are closed on destruction.
+class LocalSocket
+{
+public:
+    LocalSocket() = default;
+    ~LocalSocket();
+
+    LocalSocket(LocalSocket&& other);
+    LocalSocket& operator=(LocalSocket&& other);
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+
+    // replaces a stale socket file left at path
+    bool listen(const std::string& path);
+    // blocks until a client connects; an invalid socket if accepting failed
+    LocalSocket accept();
+    bool connect(const std::string& path);
+
+    bool isValid() const;
+    void close();
+
+    // both return false unless all bytes were transferred
+    bool readAll(void* data, size_t bytes);
+    bool writeAll(const void* data, size_t bytes);
+
+private:
+    // a SOCKET on Windows, a file descriptor elsewhere
+    intptr_t handle = -1;
+
+    explicit LocalSocket(intptr_t handle) : handle(handle) {}
+};
+
+// Read-only view of a whole file, shared with every other process mapping it.
+// The mapping stays valid if the file is deleted meanwhile.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* view = nullptr;
+    size_t length = 0;
+    // the file and mapping handles on Windows
+    void* file = nullptr;
+    void* mapping = nullptr;
+};
@@ -3,14 +3,78 @@
 
 #include "TriangleSubdivison.h"
 
-class LoopSubdivision : public TriangleSubdivison
+// weight of each neighbor when moving a vertex of valence n, 3/16 for n = 3 and 3/(8n) above
+constexpr float loopBeta(int n)
+{
+    return n < 3 ? 0.0f : n == 3 ? 0.1875f : 3.0f / (8.0f * n);
+}
+
+class LoopSubdivision : public TriangleSubdivisonScheme<LoopSubdivision>
 {
 public:
     LoopSubdivision() = default;
 
 private:
-    virtual Vertex* createBoundaryVertex(HalfEdge* he, Mesh* mesh);
-    virtual Vertex* createInteriorVertex(HalfEdge* he, Mesh* mesh);
-    Vertex* moveVertex(Vertex* v, Mesh* mesh);
+    friend class TriangleSubdivisonScheme<LoopSubdivision>;
+
+    // valences up to this are looked up instead of divided
+    static constexpr int maxTableValence = 12;
+    static constexpr float betaTable[maxTableValence + 1] = {
+        loopBeta(0), loopBeta(1), loopBeta(2), loopBeta(3), loopBeta(4), loopBeta(5), loopBeta(6),
+        loopBeta(7), loopBeta(8), loopBeta(9), loopBeta(10), loopBeta(11), loopBeta(12)
+    };
+
+    // defined here, so they inline into the loops of TriangleSubdivisonScheme
+    template <class Topology>
+    void boundaryStencil(const Topology& mesh, typename Topology::HalfEdgeHandle he, BasicStencil<typename Topology::VertexHandle>& stencil)
+    {
+        // Midpoint of the edge
+        stencil.add(mesh.origin(he), 0.5f);
+        stencil.add(mesh.origin(mesh.twin(he)), 0.5f);
+    }
+
+    template <class Topology>
+    void interiorStencil(const Topology& mesh, typename Topology::HalfEdgeHandle he, BasicStencil<typename Topology::VertexHandle>& stencil)
+    {
+        auto v0 = mesh.origin(he);
+        auto v1 = mesh.origin(mesh.twin(he));
+        auto v2 = mesh.origin(mesh.twin(mesh.next(he)));
+        auto v3 = mesh.origin(mesh.twin(mesh.next(mesh.twin(he))));
+
+        // Loop formula
+        stencil.add(v0, 0.375f);
+        stencil.add(v1, 0.375f);
+        stencil.add(v2, 0.125f);
+        stencil.add(v3, 0.125f);
+    }
+
+    template <class Topology>
+    void vertexStencil(const Topology& mesh, typename Topology::VertexHandle v, BasicStencil<typename Topology::VertexHandle>& stencil)
+    {
+        // check how many neighbor vertices
+        int n = mesh.valence(v);
+
+        // n = 2 -> boundary
+        if (n == 2) {
+            stencil.add(v, 0.75f);
+            for (auto neighborVertex : mesh.oneRing(v))
+            {
+                stencil.add(neighborVertex, 0.125f);
+            }
+        }
+        // n >= 3 -> interior
+        else if (n >= 3) {
+            float beta = n <= maxTableValence ? betaTable[n] : loopBeta(n);
+            stencil.add(v, 1.0f - n * beta);
+            for (auto neighborVertex : mesh.oneRing(v))
+            {
+                stencil.add(neighborVertex, beta);
+            }
+        }
+        else {
+            std::cout << "Error: Vertex " << mesh.vertexName(v) << " has " << n << " neighbor vertices!" << std::endl;
+            stencil.add(v, 1.0f);
+        }
+    }
 };
 
@@ -0,0 +1,138 @@
+#include "MemoryEstimate.h"
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <array>
+#include <sstream>
+
+LevelEstimate MemoryEstimate::current(const Mesh& mesh)
+{
+    LevelEstimate level;
+    level.vertices = mesh.vertices.size();
+    level.halfEdges = mesh.halfEdges.size();
+    level.faces = mesh.faces.size();
+    for (HalfEdge* he : mesh.halfEdges) {
+        if (he->isBoundaryEdge())
+            level.boundaryEdges++;
+    }
+    level.meshBytes = mesh.memoryUsage();
+    level.peakBytes = level.meshBytes;
+    return level;
+}
+
+std::vector<LevelEstimate> MemoryEstimate::predict(const Mesh& mesh, int levels, bool moveVertices)
+{
+    std::vector<LevelEstimate> estimates;
+    LevelEstimate level = current(mesh);
+    for (int i = 0; i < levels; ++i) {
+        level = next(level, moveVertices);
+        estimates.push_back(level);
+    }
+    return estimates;
+}
+
+LevelEstimate MemoryEstimate::next(const LevelEstimate& level, bool moveVertices)
+{
+    const size_t pointerBytes = sizeof(void*);
+    size_t edges = level.halfEdges / 2;
+
+    LevelEstimate result;
+    result.level = level.level + 1;
+    result.vertices = level.vertices + edges;
+    result.faces = level.faces * 4;
+    result.boundaryEdges = level.boundaryEdges * 2;
+    result.halfEdges = result.faces * 3 + result.boundaryEdges;
+    result.meshBytes = meshBytes(result.vertices, result.halfEdges, result.faces, true);
+
+    // the previous level stays alive until the new faces are built
+    size_t edgeVertexMap = hashBytes(level.halfEdges, sizeof(std::pair<HalfEdge* const, Vertex*>));
+    size_t copies = moveVertices ? level.vertices : 0;
+
+    // edge points and moved copies next to the old vertices
+    size_t moving = level.meshBytes + (edges + copies) * sizeof(Vertex) + edgeVertexMap
+        + (moveVertices ? hashBytes(level.vertices, sizeof(std::pair<Vertex* const, Vertex*>)) + copies * pointerBytes : 0);
+
+    // old vertices are gone, new half-edges and faces are built next to the old ones
+    size_t building = level.meshBytes - copies * sizeof(Vertex) + (edges + copies) * sizeof(Vertex) + edgeVertexMap
+        + hashBytes(edges, pointerBytes) + result.vertices * pointerBytes
+        + result.faces * 3 * (sizeof(HalfEdge) + pointerBytes) + result.faces * (sizeof(Face) + pointerBytes);
+
+    // twin search in createTwinEdges buckets every half-edge by its origin
+    size_t twins = meshBytes(result.vertices, result.halfEdges, result.faces, false)
+        + hashBytes(result.vertices, sizeof(std::pair<Vertex* const, std::vector<HalfEdge*>>)) + result.halfEdges * pointerBytes
+        + hashBytes(result.boundaryEdges, sizeof(std::pair<Vertex* const, HalfEdge*>));
+
+    result.peakBytes = std::max(std::max(moving, building), std::max(twins, result.meshBytes));
+    return result;
+}
+
+std::vector<LevelEstimate> MemoryEstimate::predictSqrt3(const Mesh& mesh, int levels, int firstLevel)
+{
+    std::vector<LevelEstimate> estimates;
+    LevelEstimate level = current(mesh);
+    for (int i = 0; i < levels; ++i) {
+        level = nextSqrt3(level, (firstLevel + i) % 2 == 1);
+        estimates.push_back(level);
+    }
+    return estimates;
+}
+
+LevelEstimate MemoryEstimate::nextSqrt3(const LevelEstimate& level, bool trisectBoundary)
+{
+    const size_t pointerBytes = sizeof(void*);
+
+    LevelEstimate result;
+    result.level = level.level + 1;
+    result.vertices = level.vertices + level.faces + (trisectBoundary ? level.boundaryEdges * 2 : 0);
+    result.faces = level.faces * 3 + (trisectBoundary ? level.boundaryEdges * 2 : 0);
+    result.boundaryEdges = trisectBoundary ? level.boundaryEdges * 3 : level.boundaryEdges;
+    result.halfEdges = result.faces * 3 + result.boundaryEdges;
+    result.meshBytes = meshBytes(result.vertices, result.halfEdges, result.faces, true);
+
+    // the level is built on two TriangleMesh levels next to the old mesh
+    size_t fine = TriangleMesh::bytesFor(result.vertices, result.faces, result.boundaryEdges);
+    size_t building = level.meshBytes + TriangleMesh::bytesFor(level.vertices, level.faces, level.boundaryEdges) + fine
+        + result.faces * 3 * sizeof(int) + result.vertices * 3 * sizeof(float) + level.boundaryEdges * sizeof(int);
+
+    // the new mesh is built from nested index lists while the old one is alive, then searches its twins
+    size_t lists = result.vertices * (sizeof(std::vector<float>) + 3 * sizeof(float)) + result.faces * (sizeof(std::vector<int>) + 3 * sizeof(int));
+    size_t twins = level.meshBytes + fine + lists + meshBytes(result.vertices, result.halfEdges, result.faces, false)
+        + hashBytes(result.vertices, sizeof(std::pair<Vertex* const, std::vector<HalfEdge*>>)) + result.halfEdges * pointerBytes
+        + hashBytes(result.boundaryEdges, sizeof(std::pair<Vertex* const, HalfEdge*>));
+
+    result.peakBytes = std::max(std::max(building, twins), result.meshBytes);
+    return result;
+}
+
+size_t MemoryEstimate::meshBytes(size_t vertices, size_t halfEdges, size_t faces, bool withNormals)
+{
+    size_t bytes = sizeof(Mesh);
+    bytes += vertices * (sizeof(Vertex) + sizeof(Vertex*));
+    bytes += halfEdges * (sizeof(HalfEdge) + sizeof(HalfEdge*));
+    bytes += faces * (sizeof(Face) + sizeof(Face*));
+    if (withNormals) {
+        bytes += hashBytes(vertices, sizeof(std::pair<Vertex* const, std::array<float, 3>>));
+        bytes += hashBytes(faces, sizeof(std::pair<Face* const, std::array<float, 3>>));
+    }
+    return bytes;
+}
+
+size_t MemoryEstimate::hashBytes(size_t entries, size_t entryBytes, size_t buckets)
+{
+    if (buckets == 0)
+        buckets = entries;
+    return entries * (entryBytes + sizeof(void*)) + buckets * sizeof(void*);
+}
+
+std::string MemoryEstimate::formatBytes(size_t bytes)
+{
+    std::ostringstream ss;
+    ss.precision(3);
+    if (bytes >= (size_t(1) << 30))
+        ss << bytes / double(size_t(1) << 30) << " GB";
+    else if (bytes >= (size_t(1) << 20))
+        ss << bytes / double(size_t(1) << 20) << " MB";
+    else
+        ss << bytes / 1024.0 << " KB";
+    return ss.str();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "HalfEdge.h"
+
+#include <string>
+#include <vector>
+
+// Element counts and memory of one subdivision level
+struct LevelEstimate {
+    int level = 0;
+    size_t vertices = 0;
+    size_t halfEdges = 0;       // boundary half-edges included
+    size_t faces = 0;
+    size_t boundaryEdges = 0;
+    size_t meshBytes = 0;       // the finished level, as Mesh::memoryUsage counts it
+    size_t peakBytes = 0;       // while the level is built from the previous one
+};
+
+// Predicts the size of subdivision levels before anything is allocated.
+// Every level splits each triangle in four, so the counts are exact for triangle meshes:
+// V' = V + E, F' = 4F, B' = 2B and H' = 3F' + B'. The byte figures follow the containers
+// TriangleSubdivison::subdivide keeps alive at the same time.
+class MemoryEstimate
+{
+public:
+    static LevelEstimate current(const Mesh& mesh);
+    static std::vector<LevelEstimate> predict(const Mesh& mesh, int levels, bool moveVertices);
+    static LevelEstimate next(const LevelEstimate& level, bool moveVertices);
+    // Sqrt3Subdivision triples the faces instead: V' = V + F, F' = 3F and B' = B, and on the
+    // levels that trisect the boundary 2B more vertices and faces with B' = 3B
+    static std::vector<LevelEstimate> predictSqrt3(const Mesh& mesh, int levels, int firstLevel);
+    static LevelEstimate nextSqrt3(const LevelEstimate& level, bool trisectBoundary);
+
+    static size_t meshBytes(size_t vertices, size_t halfEdges, size_t faces, bool withNormals);
+    // node per entry plus one bucket pointer per bucket, buckets default to the entry count
+    static size_t hashBytes(size_t entries, size_t entryBytes, size_t buckets = 0);
+    static std::string formatBytes(size_t bytes);
+};
@@ -0,0 +1,356 @@
+#include "MeshDecimation.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+
+constexpr double MeshDecimation::boundaryWeight;
+
+namespace {
+    typedef std::array<double, 3> Vec3;
+
+    Vec3 sub(const Vec3& a, const Vec3& b) { return { a[0] - b[0], a[1] - b[1], a[2] - b[2] }; }
+    Vec3 cross(const Vec3& a, const Vec3& b) { return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] }; }
+    double dot(const Vec3& a, const Vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+    // symmetric 4x4 matrix, stored as a2 ab ac ad b2 bc bd c2 cd d2
+    struct Quadric {
+        double q[10] = { 0.0 };
+
+        void addPlane(const Vec3& n, double d, double weight)
+        {
+            double p[4] = { n[0], n[1], n[2], d };
+            int k = 0;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = i; j < 4; ++j) {
+                    q[k++] += weight * p[i] * p[j];
+                }
+            }
+        }
+
+        Quadric operator+(const Quadric& other) const
+        {
+            Quadric sum;
+            for (int i = 0; i < 10; ++i) sum.q[i] = q[i] + other.q[i];
+            return sum;
+        }
+
+        double evaluate(const Vec3& p) const
+        {
+            double x = p[0], y = p[1], z = p[2];
+            return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                + q[7] * z * z + 2 * q[8] * z + q[9];
+        }
+
+        // minimizer of the error, false if the matrix is close to singular
+        bool optimal(Vec3& p) const
+        {
+            double a = q[0], b = q[1], c = q[2], e = q[4], f = q[5], h = q[7];
+            double det = a * (e * h - f * f) - b * (b * h - f * c) + c * (b * f - e * c);
+            double scale = std::max(std::abs(a), std::max(std::abs(e), std::abs(h)));
+            if (std::abs(det) <= 1e-12 * scale * scale * scale)
+                return false;
+
+            double r0 = -q[3], r1 = -q[6], r2 = -q[8];
+            p[0] = (r0 * (e * h - f * f) - b * (r1 * h - f * r2) + c * (r1 * f - e * r2)) / det;
+            p[1] = (a * (r1 * h - f * r2) - r0 * (b * h - f * c) + c * (b * r2 - r1 * c)) / det;
+            p[2] = (a * (e * r2 - r1 * f) - b * (b * r2 - r1 * c) + r0 * (b * f - e * c)) / det;
+            return true;
+        }
+    };
+
+    struct Candidate {
+        double cost;
+        int a, b;
+        unsigned versionA, versionB;
+        Vec3 position;
+
+        bool operator<(const Candidate& other) const { return cost > other.cost; }
+    };
+
+    class Decimator {
+    public:
+        std::vector<Vec3> positions;
+        std::vector<std::array<int, 3>> triangles;
+        size_t aliveTriangles = 0;
+
+        void initialize()
+        {
+            size_t vertexCount = positions.size();
+            quadrics.assign(vertexCount, Quadric());
+            vertexTriangles.assign(vertexCount, std::vector<int>());
+            vertexAlive.assign(vertexCount, true);
+            boundary.assign(vertexCount, false);
+            versions.assign(vertexCount, 0);
+            triangleAlive.assign(triangles.size(), true);
+            aliveTriangles = triangles.size();
+
+            std::unordered_map<uint64_t, int> edgeUses;
+            edgeUses.reserve(triangles.size() * 3 / 2);
+            for (int t = 0; t < static_cast<int>(triangles.size()); ++t) {
+                const auto& tri = triangles[t];
+                Vec3 n = cross(sub(positions[tri[1]], positions[tri[0]]), sub(positions[tri[2]], positions[tri[0]]));
+                double length = std::sqrt(dot(n, n));
+                for (int c = 0; c < 3; ++c) {
+                    vertexTriangles[tri[c]].push_back(t);
+                    edgeUses[edgeKey(tri[c], tri[(c + 1) % 3])]++;
+                }
+                if (length == 0.0)
+                    continue;
+
+                // area weighted face plane
+                Vec3 unit = { n[0] / length, n[1] / length, n[2] / length };
+                for (int c = 0; c < 3; ++c) {
+                    quadrics[tri[c]].addPlane(unit, -dot(unit, positions[tri[0]]), length / 2.0);
+                }
+            }
+
+            // planes through boundary edges, perpendicular to their face
+            for (const auto& tri : triangles) {
+                Vec3 n = cross(sub(positions[tri[1]], positions[tri[0]]), sub(positions[tri[2]], positions[tri[0]]));
+                for (int c = 0; c < 3; ++c) {
+                    int a = tri[c], b = tri[(c + 1) % 3];
+                    if (edgeUses[edgeKey(a, b)] != 1)
+                        continue;
+                    boundary[a] = boundary[b] = true;
+
+                    Vec3 edge = sub(positions[b], positions[a]);
+                    Vec3 m = cross(edge, n);
+                    double length = std::sqrt(dot(m, m));
+                    if (length == 0.0)
+                        continue;
+                    m = { m[0] / length, m[1] / length, m[2] / length };
+                    double weight = MeshDecimation::boundaryWeight * dot(edge, edge);
+                    quadrics[a].addPlane(m, -dot(m, positions[a]), weight);
+                    quadrics[b].addPlane(m, -dot(m, positions[a]), weight);
+                }
+            }
+
+            for (const auto& entry : edgeUses) {
+                int a = static_cast<int>(entry.first >> 32), b = static_cast<int>(entry.first & 0xffffffffu);
+                pushCandidate(a, b);
+            }
+        }
+
+        void run(size_t targetFaces)
+        {
+            while (aliveTriangles > targetFaces && !heap.empty()) {
+                Candidate candidate = heap.top();
+                heap.pop();
+
+                int a = candidate.a, b = candidate.b;
+                if (!vertexAlive[a] || !vertexAlive[b] || versions[a] != candidate.versionA || versions[b] != candidate.versionB)
+                    continue;
+                if (!canCollapse(a, b, candidate.position))
+                    continue;
+                collapse(a, b, candidate.position);
+            }
+        }
+
+        bool isTriangleAlive(int t) const { return triangleAlive[t]; }
+
+    private:
+        std::vector<Quadric> quadrics;
+        std::vector<std::vector<int>> vertexTriangles;
+        std::vector<bool> triangleAlive;
+        std::vector<bool> vertexAlive;
+        std::vector<bool> boundary;
+        std::vector<unsigned> versions;
+        std::priority_queue<Candidate> heap;
+
+        static uint64_t edgeKey(int a, int b)
+        {
+            if (a > b) std::swap(a, b);
+            return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+        }
+
+        static bool contains(const std::array<int, 3>& tri, int v)
+        {
+            return tri[0] == v || tri[1] == v || tri[2] == v;
+        }
+
+        // third vertices of the triangles on edge ab
+        std::vector<int> opposites(int a, int b) const
+        {
+            std::vector<int> result;
+            for (int t : vertexTriangles[a]) {
+                if (!triangleAlive[t] || !contains(triangles[t], b))
+                    continue;
+                for (int v : triangles[t]) {
+                    if (v != a && v != b) result.push_back(v);
+                }
+            }
+            return result;
+        }
+
+        std::vector<int> neighbours(int v) const
+        {
+            std::vector<int> result;
+            for (int t : vertexTriangles[v]) {
+                if (!triangleAlive[t])
+                    continue;
+                for (int u : triangles[t]) {
+                    if (u != v) result.push_back(u);
+                }
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+            return result;
+        }
+
+        void pushCandidate(int a, int b)
+        {
+            bool edgeOnBoundary = opposites(a, b).size() == 1;
+            // an interior edge between two boundary vertices would pinch the surface
+            if (boundary[a] && boundary[b] && !edgeOnBoundary)
+                return;
+
+            Quadric q = quadrics[a] + quadrics[b];
+            Vec3 p;
+            if (boundary[a] && !boundary[b]) {
+                p = positions[a];
+            }
+            else if (boundary[b] && !boundary[a]) {
+                p = positions[b];
+            }
+            else if (!q.optimal(p)) {
+                const Vec3& pa = positions[a];
+                const Vec3& pb = positions[b];
+                Vec3 mid = { (pa[0] + pb[0]) / 2, (pa[1] + pb[1]) / 2, (pa[2] + pb[2]) / 2 };
+                p = mid;
+                if (q.evaluate(pa) < q.evaluate(p)) p = pa;
+                if (q.evaluate(pb) < q.evaluate(p)) p = pb;
+            }
+
+            heap.push({ std::max(0.0, q.evaluate(p)), a, b, versions[a], versions[b], p });
+        }
+
+        bool canCollapse(int a, int b, const Vec3& p) const
+        {
+            std::vector<int> opposite = opposites(a, b);
+            if (opposite.empty())
+                return false;
+
+            // link condition: the only shared neighbours are the tips of the triangles on the edge
+            std::vector<int> na = neighbours(a), nb = neighbours(b), shared;
+            std::set_intersection(na.begin(), na.end(), nb.begin(), nb.end(), std::back_inserter(shared));
+            for (int v : shared) {
+                if (std::find(opposite.begin(), opposite.end(), v) == opposite.end())
+                    return false;
+            }
+            if (shared.size() != opposite.size())
+                return false;
+
+            // the remaining faces around a and b must not flip or collapse
+            for (int v : { a, b }) {
+                for (int t : vertexTriangles[v]) {
+                    const auto& tri = triangles[t];
+                    if (!triangleAlive[t] || (contains(tri, a) && contains(tri, b)))
+                        continue;
+
+                    Vec3 corners[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+                    Vec3 before = cross(sub(corners[1], corners[0]), sub(corners[2], corners[0]));
+                    for (int c = 0; c < 3; ++c) {
+                        if (tri[c] == v) corners[c] = p;
+                    }
+                    Vec3 after = cross(sub(corners[1], corners[0]), sub(corners[2], corners[0]));
+                    if (dot(before, after) <= 0.0)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        // b is merged into a, which moves to p
+        void collapse(int a, int b, const Vec3& p)
+        {
+            for (int t : vertexTriangles[b]) {
+                if (!triangleAlive[t])
+                    continue;
+                auto& tri = triangles[t];
+                if (contains(tri, a)) {
+                    triangleAlive[t] = false;
+                    aliveTriangles--;
+                    continue;
+                }
+                for (int& v : tri) {
+                    if (v == b) v = a;
+                }
+                vertexTriangles[a].push_back(t);
+            }
+
+            auto& own = vertexTriangles[a];
+            own.erase(std::remove_if(own.begin(), own.end(), [this](int t) { return !triangleAlive[t]; }), own.end());
+            std::vector<int>().swap(vertexTriangles[b]);
+
+            positions[a] = p;
+            quadrics[a] = quadrics[a] + quadrics[b];
+            boundary[a] = boundary[a] || boundary[b];
+            vertexAlive[b] = false;
+            versions[a]++;
+            versions[b]++;
+
+            for (int n : neighbours(a)) {
+                pushCandidate(a, n);
+            }
+        }
+    };
+}
+
+Mesh* MeshDecimation::decimate(const Mesh& mesh, size_t targetFaces)
+{
+    Decimator decimator;
+
+    std::unordered_map<const Vertex*, int> vertexIndex;
+    vertexIndex.reserve(mesh.vertices.size());
+    for (const Vertex* v : mesh.vertices) {
+        vertexIndex[v] = static_cast<int>(decimator.positions.size());
+        decimator.positions.push_back({ v->x, v->y, v->z });
+    }
+
+    for (const Face* face : mesh.faces) {
+        int first = vertexIndex[face->edge->origin];
+        for (HalfEdge* he = face->edge->next; he->next != face->edge; he = he->next) {
+            decimator.triangles.push_back({ first, vertexIndex[he->origin], vertexIndex[he->next->origin] });
+        }
+    }
+
+    size_t inputTriangles = decimator.triangles.size();
+    decimator.initialize();
+    decimator.run(targetFaces);
+
+    // keep the vertices still used by a face, in their original order
+    std::vector<int> remap(decimator.positions.size(), 0);
+    for (int t = 0; t < static_cast<int>(decimator.triangles.size()); ++t) {
+        if (!decimator.isTriangleAlive(t))
+            continue;
+        for (int v : decimator.triangles[t]) remap[v] = 1;
+    }
+
+    MeshArrays arrays;
+    for (size_t v = 0; v < remap.size(); ++v) {
+        if (remap[v] == 0)
+            continue;
+        const Vec3& p = decimator.positions[v];
+        remap[v] = static_cast<int>(arrays.vertexCount());
+        arrays.addVertex(static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]));
+    }
+
+    arrays.faceOffsets.reserve(decimator.aliveTriangles + 1);
+    arrays.faceIndices.reserve(decimator.aliveTriangles * 3);
+    for (int t = 0; t < static_cast<int>(decimator.triangles.size()); ++t) {
+        if (!decimator.isTriangleAlive(t))
+            continue;
+        for (int v : decimator.triangles[t]) arrays.faceIndices.push_back(remap[v]);
+        arrays.endFace();
+    }
+
+    std::cout << "decimated " << inputTriangles << " triangles to " << arrays.faceCount() << std::endl;
+    return new Mesh(arrays);
+}
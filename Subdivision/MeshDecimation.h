@@ -0,0 +1,17 @@
+#pragma once
+#include "HalfEdge.h"
+
+// Simplifies a mesh by quadric error edge collapses (Garland and Heckbert 1997).
+// Edges are collapsed cheapest first from a heap whose stale entries are skipped by vertex
+// versions. A collapse is refused if it breaks the link condition or flips a face. Boundary
+// vertices only move along the boundary, held there by constraint planes, so open meshes keep
+// their outline. Polygons are split into triangle fans first, the result is a triangle mesh.
+class MeshDecimation
+{
+public:
+    // returns a new mesh with at most targetFaces faces, or as few as the checks allow
+    static Mesh* decimate(const Mesh& mesh, size_t targetFaces);
+
+    // weight of the boundary constraint planes relative to the face planes
+    static constexpr double boundaryWeight = 1000.0;
+};
@@ -0,0 +1,220 @@
+#include "MeshReorder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <iostream>
+#include <unordered_map>
+
+void MeshReorder::reorder(Mesh* mesh, int cacheSize)
+{
+    reorderVertices(mesh);
+    reorderFaces(mesh, cacheSize);
+
+    std::cout << "reordered mesh elements" << std::endl;
+}
+
+void MeshReorder::reorderVertices(Mesh* mesh)
+{
+    float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (Vertex* v : mesh->vertices) {
+        float p[3] = { v->x, v->y, v->z };
+        for (int c = 0; c < 3; ++c) {
+            minPos[c] = std::min(minPos[c], p[c]);
+            maxPos[c] = std::max(maxPos[c], p[c]);
+        }
+    }
+
+    std::vector<std::pair<uint32_t, int>> order;
+    order.reserve(mesh->vertices.size());
+    for (size_t i = 0; i < mesh->vertices.size(); ++i) {
+        Vertex* v = mesh->vertices[i];
+        float p[3] = { v->x, v->y, v->z };
+        order.push_back({ mortonCode(p, minPos, maxPos), static_cast<int>(i) });
+    }
+    // stable, so vertices in the same cell keep their relative order
+    std::stable_sort(order.begin(), order.end(),
+        [](const std::pair<uint32_t, int>& lhs, const std::pair<uint32_t, int>& rhs) { return lhs.first < rhs.first; });
+
+    std::vector<Vertex*> oldVertices = mesh->vertices;
+    std::vector<int> vertexOrder(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        mesh->vertices[i] = oldVertices[order[i].second];
+        vertexOrder[i] = order[i].second;
+    }
+    permuteChannels(mesh, false, vertexOrder, std::vector<int>());
+}
+
+void MeshReorder::reorderFaces(Mesh* mesh, int cacheSize)
+{
+    const int vertexCount = static_cast<int>(mesh->vertices.size());
+    const int faceCount = static_cast<int>(mesh->faces.size());
+
+    std::unordered_map<Vertex*, int> vertexIndex;
+    vertexIndex.reserve(vertexCount);
+    for (int i = 0; i < vertexCount; ++i) {
+        vertexIndex[mesh->vertices[i]] = i;
+    }
+
+    // face corners and vertex -> face adjacency
+    std::vector<int> faceCornerOffsets(faceCount + 1, 0);
+    std::vector<int> faceCorners;
+    for (int f = 0; f < faceCount; ++f) {
+        HalfEdge* startEdge = mesh->faces[f]->edge;
+        HalfEdge* currEdge = startEdge;
+        do {
+            faceCorners.push_back(vertexIndex[currEdge->origin]);
+            currEdge = currEdge->next;
+        } while (currEdge != startEdge);
+        faceCornerOffsets[f + 1] = static_cast<int>(faceCorners.size());
+    }
+
+    std::vector<int> adjacencyOffsets(vertexCount + 1, 0);
+    for (int v : faceCorners) adjacencyOffsets[v + 1]++;
+    for (int v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<int> adjacency(faceCorners.size());
+    std::vector<int> liveFaces(vertexCount, 0);
+    {
+        std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (int f = 0; f < faceCount; ++f) {
+            for (int c = faceCornerOffsets[f]; c < faceCornerOffsets[f + 1]; ++c) {
+                adjacency[fill[faceCorners[c]]++] = f;
+                liveFaces[faceCorners[c]]++;
+            }
+        }
+    }
+
+    // Tipsify: fan out around the current vertex, then continue with the vertex that is
+    // still in the cache and has the fewest live faces left
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(faceCount, false);
+    std::vector<int> deadEnds;
+    std::vector<Face*> newFaces;
+    std::vector<int> faceOrder;
+    newFaces.reserve(faceCount);
+    faceOrder.reserve(faceCount);
+
+    int timeStamp = cacheSize + 1;
+    int cursor = 0;
+    int fanning = vertexCount > 0 ? 0 : -1;
+
+    while (fanning >= 0) {
+        std::vector<int> candidates;
+
+        for (int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a) {
+            int f = adjacency[a];
+            if (emitted[f])
+                continue;
+
+            for (int c = faceCornerOffsets[f]; c < faceCornerOffsets[f + 1]; ++c) {
+                int v = faceCorners[c];
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveFaces[v]--;
+                if (timeStamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timeStamp++;
+                }
+            }
+            emitted[f] = true;
+            newFaces.push_back(mesh->faces[f]);
+            faceOrder.push_back(f);
+        }
+
+        int best = -1;
+        int bestPriority = -1;
+        for (int v : candidates) {
+            if (liveFaces[v] <= 0)
+                continue;
+
+            int priority = 0;
+            if (timeStamp - cacheTime[v] + 2 * liveFaces[v] <= cacheSize) {
+                priority = timeStamp - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+
+        // dead end: go back to a recently used vertex, else to the next one along the Morton order
+        while (best < 0 && !deadEnds.empty()) {
+            int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveFaces[v] > 0) best = v;
+        }
+        while (best < 0 && cursor < vertexCount) {
+            if (liveFaces[cursor] > 0) best = cursor;
+            cursor++;
+        }
+
+        fanning = best;
+    }
+
+    mesh->faces = newFaces;
+    permuteChannels(mesh, true, faceOrder, faceCornerOffsets);
+    reorderHalfEdges(mesh);
+}
+
+void MeshReorder::reorderHalfEdges(Mesh* mesh)
+{
+    std::vector<HalfEdge*> newHalfEdges;
+    newHalfEdges.reserve(mesh->halfEdges.size());
+
+    for (Face* face : mesh->faces) {
+        HalfEdge* startEdge = face->edge;
+        HalfEdge* currEdge = startEdge;
+        do {
+            newHalfEdges.push_back(currEdge);
+            currEdge = currEdge->next;
+        } while (currEdge != startEdge);
+    }
+
+    // boundary half-edges have no face, they keep their relative order at the end
+    for (HalfEdge* he : mesh->halfEdges) {
+        if (he->isBoundaryEdge())
+            newHalfEdges.push_back(he);
+    }
+
+    mesh->halfEdges = newHalfEdges;
+}
+
+void MeshReorder::permuteChannels(Mesh* mesh, bool faceVarying, const std::vector<int>& order, const std::vector<int>& offsets)
+{
+    for (AttributeChannel& channel : mesh->channels) {
+        if (channel.faceVarying != faceVarying)
+            continue;
+
+        std::vector<float> permuted;
+        permuted.reserve(channel.values.size());
+        for (int element : order) {
+            size_t begin = static_cast<size_t>(offsets.empty() ? element : offsets[element]) * channel.width;
+            size_t end = static_cast<size_t>(offsets.empty() ? element + 1 : offsets[element + 1]) * channel.width;
+            if (end > channel.values.size())
+                break;
+            permuted.insert(permuted.end(), channel.values.begin() + begin, channel.values.begin() + end);
+        }
+        channel.values.swap(permuted);
+    }
+}
+
+uint32_t MeshReorder::mortonCode(const float p[3], const float minPos[3], const float maxPos[3])
+{
+    uint32_t code = 0;
+    for (int c = 0; c < 3; ++c) {
+        float extent = maxPos[c] - minPos[c];
+        uint32_t cell = extent > 0.0f ? static_cast<uint32_t>((p[c] - minPos[c]) / extent * 1023.0f) : 0;
+        code |= spreadBits(cell) << c;
+    }
+    return code;
+}
+
+// spreads the lower 10 bits of v so that two zero bits separate each of them
+uint32_t MeshReorder::spreadBits(uint32_t v)
+{
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "HalfEdge.h"
+
+#include <cstdint>
+
+// Renumbers the elements of a mesh so that neighbours sit close together in memory.
+// Vertices are sorted along a Morton curve, faces are ordered for the post-transform
+// vertex cache (Tipsify, Sander et al. 2007) and half-edges follow their faces.
+// Attribute channels are permuted along with their elements.
+class MeshReorder
+{
+public:
+	void static reorder(Mesh* mesh, int cacheSize = 16);
+	void static reorderVertices(Mesh* mesh);
+	void static reorderFaces(Mesh* mesh, int cacheSize = 16);
+
+	// 30 bit Morton code of p quantized inside the [minPos, maxPos] box
+	uint32_t static mortonCode(const float p[3], const float minPos[3], const float maxPos[3]);
+private:
+	uint32_t static spreadBits(uint32_t v);
+	void static reorderHalfEdges(Mesh* mesh);
+	// order lists the old element of every new position, offsets the corner ranges of faces
+	void static permuteChannels(Mesh* mesh, bool faceVarying, const std::vector<int>& order, const std::vector<int>& offsets);
+};
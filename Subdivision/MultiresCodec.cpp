@@ -0,0 +1,419 @@
+#include "MultiresCodec.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const char magic[4] = { 'S', 'D', 'M', 'R' };
+    const uint8_t version = 1;
+    // a quotient this long is followed by the raw value instead
+    const int riceEscape = 24;
+
+    TriangleSubdivison* findScheme(const std::string& name, LoopSubdivision& loop, ButterflySubdivision& butterfly, Sqrt3Subdivision& sqrt3)
+    {
+        if (name == "loop") return &loop;
+        if (name == "butterfly") return &butterfly;
+        if (name == "sqrt3") return &sqrt3;
+        return nullptr;
+    }
+
+    // only Butterfly interpolates
+    bool movesVertices(const std::string& name)
+    {
+        return name != "butterfly";
+    }
+
+    // the prediction of the level after level, run the same way by the encoder and the decoder
+    bool predict(TriangleSubdivison& scheme, bool moveVertices, int level, TriangleMesh& mesh)
+    {
+        scheme.setLevel(level);
+        return scheme.subdivide(mesh, moveVertices);
+    }
+
+    uint32_t zigZag(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    int32_t unZigZag(uint32_t value)
+    {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        void put(uint32_t value, int bits)
+        {
+            buffer = buffer << bits | (value & ((uint64_t(1) << bits) - 1));
+            count += bits;
+            while (count >= 8) {
+                out.push_back(static_cast<uint8_t>(buffer >> (count - 8)));
+                count -= 8;
+            }
+        }
+
+        void flush()
+        {
+            if (count > 0)
+                out.push_back(static_cast<uint8_t>(buffer << (8 - count)));
+            count = 0;
+        }
+
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t buffer = 0;
+        int count = 0;
+    };
+
+    class BitReader {
+    public:
+        BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        uint32_t get(int bits)
+        {
+            while (count < bits) {
+                buffer = buffer << 8 | (position < size ? data[position] : 0);
+                overrun |= position >= size;
+                position++;
+                count += 8;
+            }
+            count -= bits;
+            return static_cast<uint32_t>((buffer >> count) & ((uint64_t(1) << bits) - 1));
+        }
+
+        bool overran() const { return overrun; }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+        uint64_t buffer = 0;
+        int count = 0;
+        bool overrun = false;
+    };
+
+    // The Rice parameter follows the running mean of the coded values, as in LOCO-I, so it adapts
+    // from the near zero details of a smooth region to the larger ones of a feature.
+    struct RiceContext {
+        uint64_t sum = 4;
+        uint32_t count = 1;
+
+        int parameter() const
+        {
+            int k = 0;
+            while ((static_cast<uint64_t>(count) << k) < sum && k < 31) ++k;
+            return k;
+        }
+
+        void update(uint32_t value)
+        {
+            sum += value;
+            if (++count == 64) {
+                sum >>= 1;
+                count >>= 1;
+            }
+        }
+    };
+
+    void writeRice(BitWriter& writer, RiceContext& context, uint32_t value)
+    {
+        int k = context.parameter();
+        uint32_t quotient = value >> k;
+        if (quotient < riceEscape) {
+            for (uint32_t i = 0; i < quotient; ++i) writer.put(1, 1);
+            writer.put(0, 1);
+            if (k > 0)
+                writer.put(value, k);
+        }
+        else {
+            for (int i = 0; i < riceEscape; ++i) writer.put(1, 1);
+            writer.put(value, 32);
+        }
+        context.update(value);
+    }
+
+    uint32_t readRice(BitReader& reader, RiceContext& context)
+    {
+        int k = context.parameter();
+        uint32_t quotient = 0;
+        while (quotient < riceEscape && reader.get(1) == 1 && !reader.overran()) quotient++;
+
+        uint32_t value;
+        if (quotient == riceEscape)
+            value = reader.get(32);
+        else
+            value = quotient << k | (k > 0 ? reader.get(k) : 0);
+        context.update(value);
+        return value;
+    }
+
+    void writeFloat(BitWriter& writer, float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writer.put(bits, 32);
+    }
+
+    float readFloat(BitReader& reader)
+    {
+        uint32_t bits = reader.get(32);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // the byte length goes in front of the payload once it is known
+    size_t beginChunk(std::vector<uint8_t>& out)
+    {
+        out.resize(out.size() + 4);
+        return out.size();
+    }
+
+    void endChunk(std::vector<uint8_t>& out, size_t start)
+    {
+        uint32_t length = static_cast<uint32_t>(out.size() - start);
+        for (int i = 0; i < 4; ++i) out[start - 4 + i] = static_cast<uint8_t>(length >> (8 * i));
+    }
+}
+
+bool MultiresEncoder::encode(const std::string& scheme, const TriangleMesh& cage, const std::vector<float>& finePositions, int levels,
+    int quantizationBits, std::vector<uint8_t>& out, float* maxError)
+{
+    LoopSubdivision loop;
+    ButterflySubdivision butterfly;
+    Sqrt3Subdivision sqrt3;
+    TriangleSubdivison* subdivision = findScheme(scheme, loop, butterfly, sqrt3);
+    if (!subdivision) {
+        std::cerr << "Unknown subdivision scheme: " << scheme << std::endl;
+        return false;
+    }
+    if (levels < 0 || levels > 255 || quantizationBits < 1 || quantizationBits > 30) {
+        std::cerr << "Levels must be 0 to 255 and quantization bits 1 to 30" << std::endl;
+        return false;
+    }
+    bool moveVertices = movesVertices(scheme);
+
+    // the plain subdivision of the cage, the finest positions are details on top of it
+    std::vector<std::vector<float>> plain(levels + 1);
+    plain[0] = cage.positions;
+    TriangleMesh current = cage;
+    for (int level = 0; level < levels; ++level) {
+        if (!predict(*subdivision, moveVertices, level, current))
+            return false;
+        plain[level + 1] = current.positions;
+    }
+    if (finePositions.size() != current.positions.size()) {
+        std::cerr << "The finest level has " << finePositions.size() / 3 << " vertices, level " << levels << " of the cage has "
+            << current.vertexCount() << std::endl;
+        return false;
+    }
+    // a vertex keeps its index on every finer level
+    auto target = [&](int level, size_t i) {
+        return level == levels ? finePositions[i] : plain[level][i] + (finePositions[i] - plain[levels][i]);
+    };
+
+    float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (size_t i = 0; i < finePositions.size(); ++i) {
+        minPos[i % 3] = std::min(minPos[i % 3], finePositions[i]);
+        maxPos[i % 3] = std::max(maxPos[i % 3], finePositions[i]);
+    }
+    float extent = std::max(std::max(maxPos[0] - minPos[0], maxPos[1] - minPos[1]), maxPos[2] - minPos[2]);
+    float step = extent > 0.0f ? extent / static_cast<float>(1u << quantizationBits) : 1.0f;
+
+    out.insert(out.end(), magic, magic + 4);
+    out.push_back(version);
+    out.push_back(static_cast<uint8_t>(scheme.size()));
+    out.insert(out.end(), scheme.begin(), scheme.end());
+    out.push_back(static_cast<uint8_t>(levels));
+    {
+        BitWriter writer(out);
+        writeFloat(writer, step);
+    }
+
+    // the cage is stored as it is, triangles as index deltas
+    TriangleMesh decoded = cage;
+    for (size_t i = 0; i < decoded.positions.size(); ++i) decoded.positions[i] = target(0, i);
+    size_t start = beginChunk(out);
+    {
+        BitWriter writer(out);
+        writer.put(static_cast<uint32_t>(decoded.vertexCount()), 32);
+        writer.put(static_cast<uint32_t>(decoded.faceCount()), 32);
+        for (float p : decoded.positions) writeFloat(writer, p);
+        RiceContext context;
+        int previous = 0;
+        for (int h = 0; h < decoded.faceCount() * 3; ++h) {
+            writeRice(writer, context, zigZag(decoded.origin(h) - previous));
+            previous = decoded.origin(h);
+        }
+        writer.flush();
+    }
+    endChunk(out, start);
+
+    for (int level = 1; level <= levels; ++level) {
+        if (!predict(*subdivision, moveVertices, level - 1, decoded))
+            return false;
+
+        start = beginChunk(out);
+        BitWriter writer(out);
+        writer.put(static_cast<uint32_t>(decoded.vertexCount()), 32);
+        RiceContext contexts[3];
+        for (size_t i = 0; i < decoded.positions.size(); ++i) {
+            double q = std::round((static_cast<double>(target(level, i)) - decoded.positions[i]) / step);
+            int32_t quantized = static_cast<int32_t>(std::max(std::min(q, 2147483647.0), -2147483647.0));
+            writeRice(writer, contexts[i % 3], zigZag(quantized));
+            decoded.positions[i] += static_cast<float>(quantized) * step;
+        }
+        writer.flush();
+        endChunk(out, start);
+    }
+
+    if (maxError) {
+        *maxError = 0.0f;
+        for (size_t i = 0; i < finePositions.size(); ++i) *maxError = std::max(*maxError, std::abs(finePositions[i] - decoded.positions[i]));
+    }
+    return true;
+}
+
+void MultiresDecoder::append(const uint8_t* data, size_t size)
+{
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+int MultiresDecoder::update()
+{
+    if (error || (!headerRead && !readHeader()))
+        return level;
+
+    const uint8_t* data;
+    size_t size;
+    while (!error && level < levels && nextChunk(data, size)) {
+        if (!(level < 0 ? decodeCage(data, size) : decodeLevel(data, size))) {
+            std::cerr << "Corrupt level " << level + 1 << " in the multiresolution stream" << std::endl;
+            error = true;
+        }
+    }
+
+    // decoded chunks are not needed again
+    buffer.erase(buffer.begin(), buffer.begin() + readOffset);
+    readOffset = 0;
+    return level;
+}
+
+bool MultiresDecoder::readHeader()
+{
+    if (buffer.size() < 6)
+        return false;
+    if (!std::equal(magic, magic + 4, buffer.begin()) || buffer[4] != version) {
+        std::cerr << "Not a multiresolution stream of version " << static_cast<int>(version) << std::endl;
+        error = true;
+        return false;
+    }
+    size_t nameLength = buffer[5];
+    size_t headerSize = 6 + nameLength + 1 + 4;
+    if (buffer.size() < headerSize)
+        return false;
+
+    schemeName.assign(buffer.begin() + 6, buffer.begin() + 6 + nameLength);
+    if (!findScheme(schemeName, loop, butterfly, sqrt3)) {
+        std::cerr << "Unknown subdivision scheme: " << schemeName << std::endl;
+        error = true;
+        return false;
+    }
+    levels = buffer[6 + nameLength];
+    BitReader reader(&buffer[7 + nameLength], 4);
+    step = readFloat(reader);
+
+    readOffset = headerSize;
+    headerRead = true;
+    return true;
+}
+
+bool MultiresDecoder::nextChunk(const uint8_t*& data, size_t& size)
+{
+    if (buffer.size() - readOffset < 4)
+        return false;
+    uint32_t length = 0;
+    for (int i = 0; i < 4; ++i) length |= static_cast<uint32_t>(buffer[readOffset + i]) << (8 * i);
+    if (buffer.size() - readOffset - 4 < length)
+        return false;
+
+    data = &buffer[readOffset + 4];
+    size = length;
+    readOffset += 4 + length;
+    return true;
+}
+
+bool MultiresDecoder::decodeCage(const uint8_t* data, size_t size)
+{
+    BitReader reader(data, size);
+    uint32_t vertexCount = reader.get(32);
+    uint32_t faceCount = reader.get(32);
+    // every coordinate takes 4 bytes and every corner at least a bit
+    if (static_cast<uint64_t>(vertexCount) * 12 + faceCount * 3ull / 8 > size)
+        return false;
+
+    std::vector<float> positions(static_cast<size_t>(vertexCount) * 3);
+    for (float& p : positions) p = readFloat(reader);
+    std::vector<int> triangles(static_cast<size_t>(faceCount) * 3);
+    RiceContext context;
+    int previous = 0;
+    for (int& idx : triangles) {
+        idx = previous + unZigZag(readRice(reader, context));
+        if (idx < 0 || static_cast<uint32_t>(idx) >= vertexCount)
+            return false;
+        previous = idx;
+    }
+    if (reader.overran())
+        return false;
+
+    mesh = TriangleMesh(std::move(positions), triangles);
+    level = 0;
+    return true;
+}
+
+bool MultiresDecoder::decodeLevel(const uint8_t* data, size_t size)
+{
+    TriangleMesh predicted = mesh;
+    if (!predict(*findScheme(schemeName, loop, butterfly, sqrt3), movesVertices(schemeName), level, predicted))
+        return false;
+
+    BitReader reader(data, size);
+    if (reader.get(32) != static_cast<uint32_t>(predicted.vertexCount()))
+        return false;
+    RiceContext contexts[3];
+    for (size_t i = 0; i < predicted.positions.size(); ++i) {
+        int32_t quantized = unZigZag(readRice(reader, contexts[i % 3]));
+        predicted.positions[i] += static_cast<float>(quantized) * step;
+    }
+    if (reader.overran())
+        return false;
+
+    mesh = std::move(predicted);
+    level++;
+    return true;
+}
+
+bool MultiresDecoder::failed() const
+{
+    return error;
+}
+
+int MultiresDecoder::levelCount() const
+{
+    return levels;
+}
+
+int MultiresDecoder::decodedLevel() const
+{
+    return level;
+}
+
+const TriangleMesh& MultiresDecoder::getMesh() const
+{
+    return mesh;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "ButterflySubdivision.h"
+#include "LoopSubdivision.h"
+#include "Sqrt3Subdivision.h"
+#include "TriangleMesh.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Progressive storage for a subdivided mesh. The stream holds the base cage, then one chunk per
+// level with the difference between the positions of the level and what the scheme predicts from
+// the level before. The differences are quantized to a fixed step and adaptive Rice coded, one
+// context per coordinate. Every level is predicted from the decoded coarser level, so the encoder
+// and decoder run the same sums and quantization errors do not add up over the levels.
+// A chunk starts with its byte length, so a client can show the cage as soon as its chunk has
+// arrived and refine whenever the next one is complete.
+//
+// Stream: "SDMR", version, scheme name, level count, quantization step, then the chunks.
+class MultiresEncoder
+{
+public:
+    // The finest positions have the topology of levels subdivisions of the cage. A vertex carries
+    // its detail, the difference between the given position and the plain subdivision, to every
+    // level it exists on, so a plain subdivided mesh costs about a bit per coordinate.
+    // The step is the largest extent of the mesh over 2^quantizationBits. false on a mismatch.
+    static bool encode(const std::string& scheme, const TriangleMesh& cage, const std::vector<float>& finePositions, int levels,
+        int quantizationBits, std::vector<uint8_t>& out, float* maxError = nullptr);
+};
+
+class MultiresDecoder
+{
+public:
+    MultiresDecoder() = default;
+
+    // bytes of the stream in order, in pieces of any size
+    void append(const uint8_t* data, size_t size);
+    // decodes every chunk received completely, returns the finest level decoded, -1 before the cage
+    int update();
+
+    bool failed() const;
+    // known once the header has arrived, -1 before
+    int levelCount() const;
+    int decodedLevel() const;
+    // the finest level decoded so far
+    const TriangleMesh& getMesh() const;
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t readOffset = 0;
+    bool headerRead = false;
+    bool error = false;
+
+    std::string schemeName;
+    int levels = -1;
+    int level = -1;
+    float step = 0.0f;
+    TriangleMesh mesh;
+
+    LoopSubdivision loop;
+    ButterflySubdivision butterfly;
+    Sqrt3Subdivision sqrt3;
+
+    bool readHeader();
+    // the payload of the next chunk, false until all of it has arrived
+    bool nextChunk(const uint8_t*& data, size_t& size);
+    bool decodeCage(const uint8_t* data, size_t size);
+    bool decodeLevel(const uint8_t* data, size_t size);
+};
@@ -0,0 +1,561 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <limits>
+#include <unordered_map>
+
+int extractFirstNumber(const std::string& coordinate) {
+    size_t firstSlash = coordinate.find('/');
+    if (firstSlash != std::string::npos) {
+        // If it's in the "vertex/texture/normal" format, take the first index
+        std::string firstPart = coordinate.substr(0, firstSlash);
+        return std::stoi(firstPart);  // Convert to integer
+    }
+    else {
+        return std::stoi(coordinate);
+    }
+}
+
+namespace {
+    // files below this are parsed as one chunk on the calling thread
+    const size_t parallelParseBytes = 4 << 20;
+    const size_t chunkBytes = 8 << 20;
+
+    enum ElementKind { POSITION = 0, TEX_COORD = 1, NORMAL = 2 };
+
+    // a negative OBJ index counts back from the element defined last, resolved after the merge
+    struct RelativeIndex {
+        size_t slot;    // position in ObjChunk::corners
+        int kind;
+        int local;      // 0-based, relative to the first element of the chunk
+    };
+
+    // The records of one newline aligned piece of the file, indices as written there.
+    // corners holds v, vt, vn of every face corner, 1-based and 0 where missing.
+    struct ObjChunk {
+        const char* begin;
+        const char* end;
+        std::vector<float> elements[3];
+        std::vector<int> faceSizes;
+        std::vector<int> corners;
+        std::vector<RelativeIndex> relativeIndices;
+        size_t offsets[3] = { 0, 0, 0 };
+        size_t faceOffset = 0;
+        size_t cornerOffset = 0;
+        size_t lineCount = 0;
+        size_t errorLine = 0;       // first line with a face corner that is not a number, 1-based in the chunk
+    };
+
+    bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    bool parseInt(const char*& p, const char* end, int& value)
+    {
+        bool negative = p < end && *p == '-';
+        if (negative || (p < end && *p == '+')) p++;
+        if (p >= end || *p < '0' || *p > '9')
+            return false;
+        value = 0;
+        while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+        if (negative) value = -value;
+        return true;
+    }
+
+    void parseFloats(const char* p, const char* end, int count, std::vector<float>& out)
+    {
+        for (int i = 0; i < count; ++i) {
+            while (p < end && isBlank(*p)) p++;
+            char* next = nullptr;
+            float value = p < end ? std::strtof(p, &next) : 0.0f;
+            if (p >= end || next == p || next > end) {
+                value = 0.0f;
+            }
+            else {
+                p = next;
+            }
+            out.push_back(value);
+        }
+    }
+
+    void parseChunk(ObjChunk& chunk)
+    {
+        const char* p = chunk.begin;
+        while (p < chunk.end) {
+            const char* nextLine = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+            if (!nextLine) nextLine = chunk.end;
+            chunk.lineCount++;
+            // a comment runs to the end of the line
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '#', nextLine - p));
+            if (!lineEnd) lineEnd = nextLine;
+            while (p < lineEnd && isBlank(*p)) p++;
+
+            if (lineEnd - p >= 2 && p[0] == 'v' && isBlank(p[1])) {
+                parseFloats(p + 2, lineEnd, 3, chunk.elements[POSITION]);
+            }
+            else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && isBlank(p[2])) {
+                parseFloats(p + 3, lineEnd, 2, chunk.elements[TEX_COORD]);
+            }
+            else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) {
+                parseFloats(p + 3, lineEnd, 3, chunk.elements[NORMAL]);
+            }
+            else if (lineEnd - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+                const char* q = p + 2;
+                int faceSize = 0;
+                bool valid = true;
+                while (true) {
+                    while (q < lineEnd && isBlank(*q)) q++;
+                    if (q >= lineEnd)
+                        break;
+
+                    // v, v/vt, v//vn or v/vt/vn
+                    int indices[3] = { 0, 0, 0 };
+                    for (int kind = POSITION; kind <= NORMAL; ++kind) {
+                        if (kind > POSITION) {
+                            if (q >= lineEnd || *q != '/')
+                                break;
+                            q++;
+                        }
+                        // only vt may be left out
+                        if (!parseInt(q, lineEnd, indices[kind]) && !(kind == TEX_COORD && q < lineEnd && *q == '/'))
+                            valid = false;
+                    }
+                    // anything else glued to the corner
+                    if (!valid || (q < lineEnd && !isBlank(*q))) {
+                        valid = false;
+                        break;
+                    }
+
+                    for (int kind = POSITION; kind <= NORMAL; ++kind) {
+                        if (indices[kind] < 0) {
+                            int defined = static_cast<int>(chunk.elements[kind].size() / (kind == TEX_COORD ? 2 : 3));
+                            chunk.relativeIndices.push_back({ chunk.corners.size(), kind, defined + indices[kind] });
+                            indices[kind] = 0;
+                        }
+                        chunk.corners.push_back(indices[kind]);
+                    }
+                    faceSize++;
+                }
+                // the file is rejected once all chunks are parsed
+                if (!valid && chunk.errorLine == 0)
+                    chunk.errorLine = chunk.lineCount;
+                else if (valid && faceSize > 0)
+                    chunk.faceSizes.push_back(faceSize);
+            }
+            p = nextLine + 1;
+        }
+    }
+
+    // Parses the whole file in newline aligned chunks, on the pool if one is given or the file is large.
+    // Per-chunk counts are turned into offsets by a prefix sum, so the merge keeps the file order.
+    bool parseOBJ(const std::string& filename, std::vector<ObjChunk>& chunks, std::string& buffer, ThreadPool* pool)
+    {
+        std::ifstream objFile(filename, std::ios::binary | std::ios::ate);
+        if (!objFile.is_open()) {
+            std::cerr << "Could not open the file: " << filename << std::endl;
+            return false;
+        }
+        size_t size = static_cast<size_t>(objFile.tellg());
+        objFile.seekg(0);
+        buffer.resize(size);
+        objFile.read(&buffer[0], size);
+
+        std::unique_ptr<ThreadPool> ownPool;
+        if (size >= parallelParseBytes && !pool) {
+            ownPool.reset(new ThreadPool());
+            pool = ownPool.get();
+        }
+
+        size_t chunkCount = 1;
+        if (pool && size >= parallelParseBytes) {
+            chunkCount = std::max(static_cast<size_t>(pool->threadCount()) * 4, size / chunkBytes + 1);
+        }
+
+        const char* data = buffer.data();
+        const char* dataEnd = data + size;
+        const char* begin = data;
+        for (size_t i = 1; i <= chunkCount && begin < dataEnd; ++i) {
+            const char* end = i == chunkCount ? dataEnd : std::max(begin, data + size * i / chunkCount);
+            end = static_cast<const char*>(std::memchr(end, '\n', dataEnd - end));
+            end = end ? end + 1 : dataEnd;
+            ObjChunk chunk;
+            chunk.begin = begin;
+            chunk.end = end;
+            chunks.push_back(std::move(chunk));
+            begin = end;
+        }
+
+        auto forEachChunk = [&](const std::function<void(ObjChunk&)>& body) {
+            if (!pool || chunks.size() == 1) {
+                for (ObjChunk& chunk : chunks) body(chunk);
+                return;
+            }
+            ThreadPool::TaskGroup group;
+            for (ObjChunk& chunk : chunks) {
+                pool->submit([&body, &chunk]() { body(chunk); }, &group);
+            }
+            pool->wait(group);
+        };
+
+        forEachChunk(parseChunk);
+
+        size_t lineBase = 0;
+        for (const ObjChunk& chunk : chunks) {
+            if (chunk.errorLine > 0) {
+                std::cerr << "Invalid face corner on line " << lineBase + chunk.errorLine << " of " << filename << std::endl;
+                return false;
+            }
+            lineBase += chunk.lineCount;
+        }
+
+        size_t totals[3] = { 0, 0, 0 };
+        size_t faces = 0, corners = 0;
+        for (ObjChunk& chunk : chunks) {
+            for (int kind = POSITION; kind <= NORMAL; ++kind) {
+                chunk.offsets[kind] = totals[kind];
+                totals[kind] += chunk.elements[kind].size() / (kind == TEX_COORD ? 2 : 3);
+            }
+            chunk.faceOffset = faces;
+            chunk.cornerOffset = corners;
+            faces += chunk.faceSizes.size();
+            corners += chunk.corners.size() / 3;
+        }
+
+        // relative indices only need the offset of their own chunk, absolute ones may point anywhere
+        forEachChunk([](ObjChunk& chunk) {
+            for (const RelativeIndex& relative : chunk.relativeIndices) {
+                chunk.corners[relative.slot] = static_cast<int>(chunk.offsets[relative.kind]) + relative.local + 1;
+            }
+        });
+
+        for (const ObjChunk& chunk : chunks) {
+            for (size_t c = 0; c < chunk.corners.size(); c += 3) {
+                if (chunk.corners[c] < 1 || static_cast<size_t>(chunk.corners[c]) > totals[POSITION]) {
+                    std::cerr << "Invalid vertex index " << chunk.corners[c] << " in " << filename << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void mergePositionsAndFaces(std::vector<ObjChunk>& chunks, std::vector<std::vector<float>>& verticesPos,
+        std::vector<std::vector<int>>& facesIndices, ThreadPool* pool)
+    {
+        size_t vertexBase = verticesPos.size(), faceBase = facesIndices.size();
+        const ObjChunk& last = chunks.back();
+        verticesPos.resize(vertexBase + last.offsets[POSITION] + last.elements[POSITION].size() / 3);
+        facesIndices.resize(faceBase + last.faceOffset + last.faceSizes.size());
+
+        auto merge = [&](ObjChunk& chunk) {
+            const std::vector<float>& positions = chunk.elements[POSITION];
+            for (size_t i = 0; i < positions.size() / 3; ++i) {
+                verticesPos[vertexBase + chunk.offsets[POSITION] + i] = { positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2] };
+            }
+            size_t corner = 0;
+            for (size_t f = 0; f < chunk.faceSizes.size(); ++f) {
+                std::vector<int>& face = facesIndices[faceBase + chunk.faceOffset + f];
+                face.resize(chunk.faceSizes[f]);
+                for (int& idx : face) {
+                    idx = chunk.corners[corner * 3];
+                    corner++;
+                }
+            }
+        };
+
+        if (!pool || chunks.size() == 1) {
+            for (ObjChunk& chunk : chunks) merge(chunk);
+            return;
+        }
+        ThreadPool::TaskGroup group;
+        for (ObjChunk& chunk : chunks) {
+            pool->submit([&merge, &chunk]() { merge(chunk); }, &group);
+        }
+        pool->wait(group);
+    }
+
+    // the same merge into flat arrays, every chunk copies its runs to the offsets of its prefix sums
+    void mergeArrays(std::vector<ObjChunk>& chunks, MeshArrays& arrays, ThreadPool* pool)
+    {
+        const ObjChunk& last = chunks.back();
+        arrays = MeshArrays();
+        arrays.positions.resize(last.offsets[POSITION] * 3 + last.elements[POSITION].size());
+        arrays.faceOffsets.resize(last.faceOffset + last.faceSizes.size() + 1);
+        arrays.faceIndices.resize(last.cornerOffset + last.corners.size() / 3);
+
+        auto merge = [&](ObjChunk& chunk) {
+            const std::vector<float>& positions = chunk.elements[POSITION];
+            std::copy(positions.begin(), positions.end(), arrays.positions.begin() + chunk.offsets[POSITION] * 3);
+            size_t corner = chunk.cornerOffset;
+            for (size_t f = 0; f < chunk.faceSizes.size(); ++f) {
+                corner += chunk.faceSizes[f];
+                arrays.faceOffsets[chunk.faceOffset + f + 1] = static_cast<int>(corner);
+            }
+            for (size_t c = 0; c < chunk.corners.size() / 3; ++c) {
+                arrays.faceIndices[chunk.cornerOffset + c] = chunk.corners[c * 3] - 1;
+            }
+        };
+
+        if (!pool || chunks.size() == 1) {
+            for (ObjChunk& chunk : chunks) merge(chunk);
+            return;
+        }
+        ThreadPool::TaskGroup group;
+        for (ObjChunk& chunk : chunks) {
+            pool->submit([&merge, &chunk]() { merge(chunk); }, &group);
+        }
+        pool->wait(group);
+    }
+
+    // a channel is kept only if every corner refers to a defined element
+    void collectChannels(const std::vector<ObjChunk>& chunks, size_t faceCount, std::vector<AttributeChannel>& channels)
+    {
+        const ObjChunk& last = chunks.back();
+        const char* names[3] = { "", "uv", "normal" };
+        for (int kind = TEX_COORD; kind <= NORMAL; ++kind) {
+            int width = kind == TEX_COORD ? 2 : 3;
+            std::vector<float> elements;
+            for (const ObjChunk& chunk : chunks) {
+                elements.insert(elements.end(), chunk.elements[kind].begin(), chunk.elements[kind].end());
+            }
+            size_t defined = elements.size() / width;
+
+            AttributeChannel channel;
+            channel.name = names[kind];
+            channel.width = width;
+            channel.faceVarying = true;
+            channel.values.reserve((last.cornerOffset + last.corners.size() / 3) * width);
+
+            bool complete = faceCount > 0;
+            for (const ObjChunk& chunk : chunks) {
+                for (size_t c = 0; c < chunk.corners.size() && complete; c += 3) {
+                    int idx = chunk.corners[c + kind];
+                    if (idx < 1 || static_cast<size_t>(idx) > defined) {
+                        complete = false;
+                        break;
+                    }
+                    channel.values.insert(channel.values.end(), elements.begin() + (idx - 1) * width, elements.begin() + idx * width);
+                }
+            }
+
+            if (complete) {
+                channels.push_back(channel);
+                std::cout << (kind == TEX_COORD ? ", texture coordinates" : ", normals");
+            }
+        }
+        std::cout << ".\n";
+    }
+}
+
+void loadOBJ(const std::string& filename, std::vector<std::vector<float>>& verticesPos, std::vector<std::vector<int>>& facesIndices,
+    ThreadPool* pool) {
+    std::string buffer;
+    std::vector<ObjChunk> chunks;
+    if (!parseOBJ(filename, chunks, buffer, pool) || chunks.empty())
+        return;
+
+    mergePositionsAndFaces(chunks, verticesPos, facesIndices, pool);
+    std::cout << "Loaded OBJ with " << verticesPos.size() << " vertices and " << facesIndices.size() << " faces.\n";
+}
+
+void loadOBJ(const std::string& filename, std::vector<std::vector<float>>& verticesPos, std::vector<std::vector<int>>& facesIndices,
+    std::vector<AttributeChannel>& channels, ThreadPool* pool) {
+    std::string buffer;
+    std::vector<ObjChunk> chunks;
+    if (!parseOBJ(filename, chunks, buffer, pool) || chunks.empty())
+        return;
+
+    mergePositionsAndFaces(chunks, verticesPos, facesIndices, pool);
+    std::cout << "Loaded OBJ with " << verticesPos.size() << " vertices and " << facesIndices.size() << " faces";
+    collectChannels(chunks, facesIndices.size(), channels);
+}
+
+void loadOBJ(const std::string& filename, MeshArrays& arrays, ThreadPool* pool) {
+    std::string buffer;
+    std::vector<ObjChunk> chunks;
+    if (!parseOBJ(filename, chunks, buffer, pool) || chunks.empty())
+        return;
+
+    mergeArrays(chunks, arrays, pool);
+    std::cout << "Loaded OBJ with " << arrays.vertexCount() << " vertices and " << arrays.faceCount() << " faces.\n";
+}
+
+void loadOBJ(const std::string& filename, MeshArrays& arrays, std::vector<AttributeChannel>& channels, ThreadPool* pool) {
+    std::string buffer;
+    std::vector<ObjChunk> chunks;
+    if (!parseOBJ(filename, chunks, buffer, pool) || chunks.empty())
+        return;
+
+    mergeArrays(chunks, arrays, pool);
+    std::cout << "Loaded OBJ with " << arrays.vertexCount() << " vertices and " << arrays.faceCount() << " faces";
+    collectChannels(chunks, arrays.faceCount(), channels);
+}
+
+bool loadOBJTriangles(const std::string& filename, std::vector<float>& positions, std::vector<int>& triangles) {
+    std::ifstream objFile(filename);
+    if (!objFile.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(objFile, line)) {
+        std::istringstream ss(line.substr(0, line.find('#')));
+        std::string token;
+        ss >> token;
+
+        if (token == "v") {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            ss >> x >> y >> z;
+            positions.push_back(x);
+            positions.push_back(y);
+            positions.push_back(z);
+        }
+        else if (token == "f") {
+            int corners = 0;
+            std::string vertexData;
+            while (ss >> vertexData) {
+                triangles.push_back(extractFirstNumber(vertexData) - 1);
+                corners++;
+            }
+            if (corners != 3) {
+                std::cerr << "Only triangle faces are supported: " << line << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << "Loaded OBJ with " << positions.size() / 3 << " vertices and " << triangles.size() / 3 << " faces.\n";
+
+    return true;
+}
+
+bool saveOBJ(const std::string& filename, const Mesh& mesh) {
+    std::ofstream objFile(filename);
+    if (!objFile.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    // enough digits to read back the exact float values
+    objFile.precision(std::numeric_limits<float>::max_digits10);
+
+    std::unordered_map<const Vertex*, int> vertexIndex;
+    vertexIndex.reserve(mesh.vertices.size());
+    for (const Vertex* v : mesh.vertices) {
+        vertexIndex[v] = static_cast<int>(vertexIndex.size()) + 1;
+        objFile << "v " << v->x << " " << v->y << " " << v->z << "\n";
+    }
+
+    // per-vertex channels share the vertex index, face-varying ones are written once per corner
+    size_t cornerCount = 0;
+    for (const Face* face : mesh.faces) cornerCount += face->degree();
+    auto fits = [&](const AttributeChannel& channel, const char* name, int width) {
+        return channel.name == name && channel.width == width
+            && channel.values.size() == (channel.faceVarying ? cornerCount : mesh.vertices.size()) * width;
+    };
+
+    const AttributeChannel* uv = nullptr;
+    const AttributeChannel* normal = nullptr;
+    for (const AttributeChannel& channel : mesh.channels) {
+        if (fits(channel, "uv", 2)) uv = &channel;
+        if (fits(channel, "normal", 3)) normal = &channel;
+    }
+    if (uv) {
+        for (size_t i = 0; i < uv->values.size(); i += 2) {
+            objFile << "vt " << uv->values[i] << " " << uv->values[i + 1] << "\n";
+        }
+    }
+    if (normal) {
+        for (size_t i = 0; i < normal->values.size(); i += 3) {
+            float length = std::sqrt(normal->values[i] * normal->values[i] + normal->values[i + 1] * normal->values[i + 1]
+                + normal->values[i + 2] * normal->values[i + 2]);
+            if (length == 0.0f) length = 1.0f;
+            objFile << "vn " << normal->values[i] / length << " " << normal->values[i + 1] / length << " " << normal->values[i + 2] / length << "\n";
+        }
+    }
+
+    int corner = 0;
+    for (const Face* face : mesh.faces) {
+        objFile << "f";
+        HalfEdge* startEdge = face->edge;
+        HalfEdge* currEdge = startEdge;
+        do {
+            int idx = vertexIndex[currEdge->origin];
+            corner++;
+            objFile << " " << idx;
+            if (uv || normal)
+                objFile << "/";
+            if (uv)
+                objFile << (uv->faceVarying ? corner : idx);
+            if (normal)
+                objFile << "/" << (normal->faceVarying ? corner : idx);
+            currEdge = currEdge->next;
+        } while (currEdge != startEdge);
+        objFile << "\n";
+    }
+
+    return static_cast<bool>(objFile);
+}
+
+bool saveOBJ(const std::string& filename, const TriangleMesh& mesh) {
+    std::ofstream objFile(filename);
+    if (!objFile.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    objFile.precision(std::numeric_limits<float>::max_digits10);
+
+    for (size_t i = 0; i < mesh.positions.size(); i += 3) {
+        objFile << "v " << mesh.positions[i] << " " << mesh.positions[i + 1] << " " << mesh.positions[i + 2] << "\n";
+    }
+    for (int f = 0; f < mesh.faceCount(); ++f) {
+        objFile << "f " << mesh.origin(f * 3) + 1 << " " << mesh.origin(f * 3 + 1) + 1 << " " << mesh.origin(f * 3 + 2) + 1 << "\n";
+    }
+
+    return static_cast<bool>(objFile);
+}
+
+bool saveOBJ(const std::string& filename, const CompactMesh& mesh) {
+    std::ofstream objFile(filename);
+    if (!objFile.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    objFile.precision(std::numeric_limits<float>::max_digits10);
+
+    float p[3];
+    for (size_t i = 0; i < mesh.vertexCount(); ++i) {
+        mesh.position(i, p);
+        objFile << "v " << p[0] << " " << p[1] << " " << p[2] << "\n";
+    }
+    if (mesh.hasNormals()) {
+        for (size_t i = 0; i < mesh.vertexCount(); ++i) {
+            mesh.normal(i, p);
+            objFile << "vn " << p[0] << " " << p[1] << " " << p[2] << "\n";
+        }
+    }
+
+    bool withNormals = mesh.hasNormals();
+    mesh.forEachFace([&objFile, withNormals](const std::vector<int>& corners) {
+        objFile << "f";
+        for (int idx : corners) {
+            objFile << " " << idx + 1;
+            if (withNormals)
+                objFile << "//" << idx + 1;
+        }
+        objFile << "\n";
+    });
+
+    return static_cast<bool>(objFile);
+}
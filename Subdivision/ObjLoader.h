@@ -0,0 +1,36 @@
+#pragma once
+#include "CompactMesh.h"
+#include "HalfEdge.h"
+#include "ThreadPool.h"
+#include "TriangleMesh.h"
+
+#include <string>
+#include <vector>
+
+int extractFirstNumber(const std::string& coordinate);
+
+// Files of a few MB and more are split into newline aligned chunks that are parsed in parallel,
+// on the given pool or a temporary one. Vertices and faces keep the order of the file.
+void loadOBJ(const std::string& filename, std::vector<std::vector<float>>& verticesPos, std::vector<std::vector<int>>& facesIndices,
+    ThreadPool* pool = nullptr);
+
+// Also reads the vt and vn references of the faces into face-varying channels "uv" (width 2)
+// and "normal" (width 3), one value per face corner. A channel is left out unless every face has it.
+void loadOBJ(const std::string& filename, std::vector<std::vector<float>>& verticesPos, std::vector<std::vector<int>>& facesIndices,
+    std::vector<AttributeChannel>& channels, ThreadPool* pool = nullptr);
+
+// Into MeshArrays, which are replaced, so no vector is allocated per vertex or face
+void loadOBJ(const std::string& filename, MeshArrays& arrays, ThreadPool* pool = nullptr);
+void loadOBJ(const std::string& filename, MeshArrays& arrays, std::vector<AttributeChannel>& channels, ThreadPool* pool = nullptr);
+
+// Flat variant: positions as x,y,z triples and triangles as 0-based index triples.
+// Returns false if the file cannot be opened or contains non-triangle faces.
+bool loadOBJTriangles(const std::string& filename, std::vector<float>& positions, std::vector<int>& triangles);
+
+// a "uv" and a "normal" channel of the mesh are written as vt and vn lines
+bool saveOBJ(const std::string& filename, const Mesh& mesh);
+
+bool saveOBJ(const std::string& filename, const TriangleMesh& mesh);
+
+// writes the dequantized positions and the stored normals as vn lines
+bool saveOBJ(const std::string& filename, const CompactMesh& mesh);
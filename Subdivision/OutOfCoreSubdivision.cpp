@@ -0,0 +1,411 @@
+#include "OutOfCoreSubdivision.h"
+#include "MeshReorder.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstdio>
+#include <limits>
+
+namespace {
+    uint64_t edgeKey(int a, int b)
+    {
+        if (a > b) std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& out, const std::vector<T>& values)
+    {
+        int32_t count = static_cast<int32_t>(values.size());
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(values.data()), sizeof(T) * values.size());
+    }
+
+    template <typename T>
+    bool readArray(std::ifstream& in, std::vector<T>& values)
+    {
+        int32_t count = 0;
+        if (!in.read(reinterpret_cast<char*>(&count), sizeof(count)) || count < 0)
+            return false;
+        values.resize(count);
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), sizeof(T) * values.size()));
+    }
+}
+
+OutOfCoreSubdivision::OutOfCoreSubdivision(TriangleSubdivison& scheme, bool moveVertices, int ringDepth, int boundaryRingDepth, int facesPerPatch)
+    : scheme(scheme), moveVertices(moveVertices), ringDepth(std::max(1, ringDepth)), boundaryRingDepth(std::max(1, boundaryRingDepth)),
+    facesPerPatch(std::max(1, facesPerPatch)), pool(nullptr) {}
+
+void OutOfCoreSubdivision::setWorkDirectory(const std::string& directory)
+{
+    workDirectory = directory;
+}
+
+void OutOfCoreSubdivision::setThreadPool(ThreadPool* threadPool)
+{
+    pool = threadPool;
+}
+
+bool OutOfCoreSubdivision::subdivide(const std::string& inputFile, const std::string& outputFile, int levels)
+{
+    if (levels < 1) {
+        std::cout << "Error: out-of-core subdivision needs at least one level" << std::endl;
+        return false;
+    }
+    if (!scheme.splitsInFour()) {
+        std::cout << "Error: out-of-core subdivision needs a scheme that splits every face in four" << std::endl;
+        return false;
+    }
+    this->levels = levels;
+
+    std::cout << "starting out-of-core subdivision of " << inputFile << std::endl;
+
+    std::vector<std::string> patchFiles;
+    int baseFaceCount = 0;
+    {
+        std::vector<float> positions;
+        std::vector<int> triangles;
+        if (!loadOBJTriangles(inputFile, positions, triangles))
+            return false;
+
+        baseVertexCount = static_cast<int>(positions.size() / 3);
+        baseFaceCount = static_cast<int>(triangles.size() / 3);
+
+        baseEdges.clear();
+        baseEdges.reserve(triangles.size());
+        for (int f = 0; f < baseFaceCount; ++f) {
+            for (int i = 0; i < 3; ++i) {
+                baseEdges.push_back(edgeKey(triangles[3 * f + i], triangles[3 * f + (i + 1) % 3]));
+            }
+        }
+        std::sort(baseEdges.begin(), baseEdges.end());
+        // an edge of a single face is on an open boundary
+        bool open = false;
+        for (size_t i = 0; i < baseEdges.size() && !open; ++i) {
+            open = (i == 0 || baseEdges[i] != baseEdges[i - 1]) && (i + 1 == baseEdges.size() || baseEdges[i] != baseEdges[i + 1]);
+        }
+        baseEdges.erase(std::unique(baseEdges.begin(), baseEdges.end()), baseEdges.end());
+
+        // patch files are named after the output, so several runs can share a work directory
+        std::string outputName = outputFile.substr(outputFile.find_last_of("/\\") + 1);
+        std::string patchPrefix = (workDirectory.empty() ? outputFile : workDirectory + "/" + outputName) + ".patch_";
+        patchFiles = writePatches(positions, triangles, (open ? boundaryRingDepth : ringDepth) * levels, patchPrefix);
+    }
+    // only the edge table of the base mesh and the owners stay in memory from here on
+    std::cout << "wrote " << patchFiles.size() << " patches" << std::endl;
+
+    const int64_t sideSegments = int64_t(1) << levels;
+    const int64_t edgePoints = sideSegments - 1;
+    const int64_t facePoints = (sideSegments - 1) * (sideSegments - 2) / 2;
+    const int64_t outputVertexCount = baseVertexCount + static_cast<int64_t>(baseEdges.size()) * edgePoints + baseFaceCount * facePoints;
+
+    std::string positionsFilename = outputFile + ".positions.tmp";
+    std::string facesFilename = outputFile + ".faces.tmp";
+    {
+        std::fstream positionsFile(positionsFilename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        std::ofstream facesFile(facesFilename);
+        if (!positionsFile.is_open() || !facesFile.is_open()) {
+            std::cerr << "Could not create temporary files next to: " << outputFile << std::endl;
+            return false;
+        }
+
+        std::atomic<bool> failed{ false };
+        auto runPatch = [&](int patchIndex, const std::string& patchFile) {
+            Patch patch;
+            if (!readPatch(patchFile, patch)) {
+                std::cerr << "Could not read patch: " << patchFile << std::endl;
+                failed = true;
+                return;
+            }
+            if (!processPatch(patchIndex, patch, positionsFile, facesFile))
+                failed = true;
+            std::remove(patchFile.c_str());
+        };
+
+        if (pool) {
+            ThreadPool::TaskGroup patchTasks;
+            for (size_t i = 0; i < patchFiles.size(); ++i) {
+                pool->submit([&runPatch, &patchFiles, i]() { runPatch(static_cast<int>(i), patchFiles[i]); }, &patchTasks);
+            }
+            pool->wait(patchTasks);
+        }
+        else {
+            for (size_t i = 0; i < patchFiles.size(); ++i) {
+                runPatch(static_cast<int>(i), patchFiles[i]);
+            }
+        }
+
+        if (failed)
+            return false;
+    }
+
+    // assemble the final OBJ: positions in global index order, then the streamed faces
+    std::ofstream objFile(outputFile);
+    std::ifstream positionsFile(positionsFilename, std::ios::binary);
+    std::ifstream facesFile(facesFilename);
+    if (!objFile.is_open()) {
+        std::cerr << "Could not open the file: " << outputFile << std::endl;
+        return false;
+    }
+
+    // enough digits to read back the exact float values
+    objFile.precision(std::numeric_limits<float>::max_digits10);
+
+    float position[3];
+    for (int64_t i = 0; i < outputVertexCount; ++i) {
+        positionsFile.read(reinterpret_cast<char*>(position), sizeof(position));
+        objFile << "v " << position[0] << " " << position[1] << " " << position[2] << "\n";
+    }
+    objFile << facesFile.rdbuf();
+
+    positionsFile.close();
+    facesFile.close();
+    std::remove(positionsFilename.c_str());
+    std::remove(facesFilename.c_str());
+
+    std::cout << "finished out-of-core subdivision with " << outputVertexCount << " vertices and "
+        << baseFaceCount * sideSegments * sideSegments << " faces" << std::endl << std::endl;
+    return true;
+}
+
+std::vector<std::string> OutOfCoreSubdivision::writePatches(const std::vector<float>& positions, const std::vector<int>& triangles, int rings,
+    const std::string& prefix)
+{
+    const int vertexCount = static_cast<int>(positions.size() / 3);
+    const int faceCount = static_cast<int>(triangles.size() / 3);
+
+    // vertex -> incident faces
+    std::vector<int> vertexFaceOffsets(vertexCount + 1, 0);
+    for (int idx : triangles) vertexFaceOffsets[idx + 1]++;
+    for (int v = 0; v < vertexCount; ++v) vertexFaceOffsets[v + 1] += vertexFaceOffsets[v];
+    std::vector<int> vertexFaces(triangles.size());
+    {
+        std::vector<int> fill(vertexFaceOffsets.begin(), vertexFaceOffsets.end() - 1);
+        for (int f = 0; f < faceCount; ++f)
+            for (int i = 0; i < 3; ++i)
+                vertexFaces[fill[triangles[3 * f + i]]++] = f;
+    }
+
+    // order faces along a Morton curve of their centroids so patches are compact
+    float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int v = 0; v < vertexCount; ++v) {
+        for (int c = 0; c < 3; ++c) {
+            minPos[c] = std::min(minPos[c], positions[3 * v + c]);
+            maxPos[c] = std::max(maxPos[c], positions[3 * v + c]);
+        }
+    }
+
+    std::vector<std::pair<uint32_t, int>> faceOrder(faceCount);
+    for (int f = 0; f < faceCount; ++f) {
+        float centroid[3];
+        for (int c = 0; c < 3; ++c) {
+            centroid[c] = (positions[3 * triangles[3 * f] + c] + positions[3 * triangles[3 * f + 1] + c] + positions[3 * triangles[3 * f + 2] + c]) / 3.0f;
+        }
+        faceOrder[f] = { MeshReorder::mortonCode(centroid, minPos, maxPos), f };
+    }
+    std::sort(faceOrder.begin(), faceOrder.end());
+
+    std::vector<std::string> patchFiles;
+    std::vector<int> faceStamp(faceCount, -1);
+    std::vector<int> localIndex(vertexCount, -1);
+    // the first patch with a core face on a base vertex or edge owns it
+    vertexOwners.assign(vertexCount, -1);
+    edgeOwners.assign(baseEdges.size(), -1);
+
+    for (int start = 0, patchIdx = 0; start < faceCount; start += facesPerPatch, ++patchIdx) {
+        int end = std::min(faceCount, start + facesPerPatch);
+
+        Patch patch;
+        std::vector<int> patchFaces;
+        for (int i = start; i < end; ++i) {
+            patch.baseFaces.push_back(faceOrder[i].second);
+            patchFaces.push_back(faceOrder[i].second);
+            faceStamp[faceOrder[i].second] = patchIdx;
+
+            const int* corners = &triangles[3 * faceOrder[i].second];
+            for (int c = 0; c < 3; ++c) {
+                if (vertexOwners[corners[c]] < 0)
+                    vertexOwners[corners[c]] = patchIdx;
+                size_t edgeId = std::lower_bound(baseEdges.begin(), baseEdges.end(), edgeKey(corners[c], corners[(c + 1) % 3])) - baseEdges.begin();
+                if (edgeOwners[edgeId] < 0)
+                    edgeOwners[edgeId] = patchIdx;
+            }
+        }
+
+        // halo: the rings the scheme needs around the patch for all the levels
+        size_t ringStart = 0;
+        for (int ring = 0; ring < rings; ++ring) {
+            size_t ringEnd = patchFaces.size();
+            for (size_t i = ringStart; i < ringEnd; ++i) {
+                int f = patchFaces[i];
+                for (int c = 0; c < 3; ++c) {
+                    int v = triangles[3 * f + c];
+                    for (int j = vertexFaceOffsets[v]; j < vertexFaceOffsets[v + 1]; ++j) {
+                        int neighbor = vertexFaces[j];
+                        if (faceStamp[neighbor] != patchIdx) {
+                            faceStamp[neighbor] = patchIdx;
+                            patchFaces.push_back(neighbor);
+                        }
+                    }
+                }
+            }
+            ringStart = ringEnd;
+        }
+
+        for (int f : patchFaces) {
+            for (int c = 0; c < 3; ++c) {
+                int v = triangles[3 * f + c];
+                if (localIndex[v] < 0) {
+                    localIndex[v] = static_cast<int>(patch.globalVertices.size());
+                    patch.globalVertices.push_back(v);
+                    patch.positions.push_back(positions[3 * v]);
+                    patch.positions.push_back(positions[3 * v + 1]);
+                    patch.positions.push_back(positions[3 * v + 2]);
+                }
+                patch.triangles.push_back(localIndex[v]);
+            }
+        }
+        for (int v : patch.globalVertices) localIndex[v] = -1;
+
+        std::stringstream patchNameStream;
+        patchNameStream << prefix << patchIdx << ".bin";
+        writePatch(patchNameStream.str(), patch);
+        patchFiles.push_back(patchNameStream.str());
+    }
+
+    return patchFiles;
+}
+
+bool OutOfCoreSubdivision::processPatch(int patchIndex, const Patch& patch, std::fstream& positionsFile, std::ostream& facesFile)
+{
+    // patches run on several threads with the same scheme, and the ordered sums of refinePatch
+    // give a seam vertex the same bits in every patch that contains it
+    TriangleMesh mesh(patch.positions, patch.triangles);
+    for (int level = 0; level < levels; ++level) {
+        TriangleMesh fine;
+        if (!scheme.refinePatch(mesh, fine, moveVertices))
+            return false;
+        mesh = std::move(fine);
+    }
+
+    // split, like rebuildFace, replaces face i with faces 4i..4i+3, so the refined faces of core face c are
+    // the block c * 4^levels, and the digits of the offset inside the block give the child path
+    const int sideSegments = 1 << levels;
+    const int childCount = sideSegments * sideSegments;
+
+    std::vector<std::pair<int64_t, std::array<float, 3>>> writtenPositions;
+    std::stringstream faceLines;
+    for (size_t c = 0; c < patch.baseFaces.size(); ++c) {
+        int baseVertices[3] = {
+            patch.globalVertices[patch.triangles[3 * c]],
+            patch.globalVertices[patch.triangles[3 * c + 1]],
+            patch.globalVertices[patch.triangles[3 * c + 2]]
+        };
+
+        for (int child = 0; child < childCount; ++child) {
+            // barycentric lattice coordinates of the corners, scaled by 2^levels
+            int corners[3][3] = { { sideSegments, 0, 0 }, { 0, sideSegments, 0 }, { 0, 0, sideSegments } };
+            for (int level = levels - 1; level >= 0; --level) {
+                int digit = (child >> (2 * level)) & 3;
+                // same corner order as the four faces built by rebuildFace
+                int a[3], b[3], cc[3], ab[3], bc[3], ca[3];
+                for (int k = 0; k < 3; ++k) {
+                    a[k] = corners[0][k]; b[k] = corners[1][k]; cc[k] = corners[2][k];
+                    ab[k] = (a[k] + b[k]) / 2; bc[k] = (b[k] + cc[k]) / 2; ca[k] = (cc[k] + a[k]) / 2;
+                }
+                const int* childCorners[4][3] = { { a, ab, ca }, { ab, bc, ca }, { ab, b, bc }, { ca, bc, cc } };
+                for (int i = 0; i < 3; ++i)
+                    for (int k = 0; k < 3; ++k)
+                        corners[i][k] = childCorners[digit][i][k];
+            }
+
+            size_t fineFace = c * childCount + child;
+            faceLines << "f";
+            for (int i = 0; i < 3; ++i) {
+                int64_t index = globalVertexIndex(corners[i], baseVertices, patch.baseFaces[c]);
+                const float* p = &mesh.positions[mesh.origin(static_cast<int>(fineFace * 3 + i)) * 3];
+                if (ownsVertex(patchIndex, index))
+                    writtenPositions.push_back({ index, { p[0], p[1], p[2] } });
+                faceLines << " " << index + 1;
+            }
+            faceLines << "\n";
+        }
+    }
+
+    // a point is met once per face around it
+    std::sort(writtenPositions.begin(), writtenPositions.end(),
+        [](const std::pair<int64_t, std::array<float, 3>>& lhs, const std::pair<int64_t, std::array<float, 3>>& rhs) { return lhs.first < rhs.first; });
+
+    // patches may run on several threads, they share the output files
+    std::lock_guard<std::mutex> lock(outputMutex);
+    facesFile << faceLines.rdbuf();
+    for (size_t i = 0; i < writtenPositions.size(); ++i) {
+        if (i > 0 && writtenPositions[i].first == writtenPositions[i - 1].first)
+            continue;
+        positionsFile.seekp(writtenPositions[i].first * static_cast<int64_t>(sizeof(float) * 3));
+        positionsFile.write(reinterpret_cast<const char*>(writtenPositions[i].second.data()), sizeof(float) * 3);
+    }
+    return true;
+}
+
+bool OutOfCoreSubdivision::ownsVertex(int patchIndex, int64_t index) const
+{
+    const int64_t sideSegments = int64_t(1) << levels;
+    if (index < baseVertexCount)
+        return vertexOwners[static_cast<size_t>(index)] == patchIndex;
+    int64_t edgeId = (index - baseVertexCount) / (sideSegments - 1);
+    // points inside a base face belong to the patch of the face
+    return edgeId >= static_cast<int64_t>(baseEdges.size()) || edgeOwners[static_cast<size_t>(edgeId)] == patchIndex;
+}
+
+int64_t OutOfCoreSubdivision::globalVertexIndex(const int lattice[3], const int baseVertices[3], int baseFace) const
+{
+    const int64_t sideSegments = int64_t(1) << levels;
+    const int64_t edgeOffset = baseVertexCount;
+    const int64_t faceOffset = edgeOffset + static_cast<int64_t>(baseEdges.size()) * (sideSegments - 1);
+
+    int nonZero = 0;
+    int used[3];
+    for (int i = 0; i < 3; ++i) {
+        if (lattice[i] > 0) used[nonZero++] = i;
+    }
+
+    // on a base vertex
+    if (nonZero == 1)
+        return baseVertices[used[0]];
+
+    // on a base edge: numbered from the endpoint with the smaller global index
+    if (nonZero == 2) {
+        int p = used[0], q = used[1];
+        if (baseVertices[p] > baseVertices[q]) std::swap(p, q);
+        int64_t edgeId = std::lower_bound(baseEdges.begin(), baseEdges.end(), edgeKey(baseVertices[p], baseVertices[q])) - baseEdges.begin();
+        return edgeOffset + edgeId * (sideSegments - 1) + (lattice[q] - 1);
+    }
+
+    // inside a base face: row by row over the interior lattice points
+    int64_t i = lattice[0], j = lattice[1];
+    int64_t local = (i - 1) * (sideSegments - 1) - (i - 1) * i / 2 + (j - 1);
+    return faceOffset + static_cast<int64_t>(baseFace) * (sideSegments - 1) * (sideSegments - 2) / 2 + local;
+}
+
+void OutOfCoreSubdivision::writePatch(const std::string& filename, const Patch& patch)
+{
+    std::ofstream out(filename, std::ios::binary);
+    writeArray(out, patch.baseFaces);
+    writeArray(out, patch.triangles);
+    writeArray(out, patch.globalVertices);
+    writeArray(out, patch.positions);
+}
+
+bool OutOfCoreSubdivision::readPatch(const std::string& filename, Patch& patch)
+{
+    std::ifstream in(filename, std::ios::binary);
+    return in.is_open()
+        && readArray(in, patch.baseFaces)
+        && readArray(in, patch.triangles)
+        && readArray(in, patch.globalVertices)
+        && readArray(in, patch.positions);
+}
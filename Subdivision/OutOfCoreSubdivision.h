@@ -0,0 +1,64 @@
+#pragma once
+#include "TriangleSubdivison.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <mutex>
+
+// Subdivides triangle OBJ files that do not fit in memory as a half-edge Mesh.
+// The base mesh is cut into patches of spatially close faces. Every patch is written to disk
+// together with a halo of face rings, ringDepth per level, then loaded and subdivided on its own
+// with the given scheme. As in StreamingSubdivision, Loop needs one ring and Butterfly two, or
+// three on meshes with open boundaries. Only the faces refined from the patch's own faces are
+// kept. Each output vertex gets a global index from the base vertex, edge or face it lies on, and
+// a point on a patch seam is written only by the patch that owns that base vertex or edge.
+// With a thread pool set, the patches are subdivided in parallel as pool tasks.
+// Only positions are written, attribute channels are not carried through the patches.
+class OutOfCoreSubdivision
+{
+public:
+    // boundaryRingDepth replaces ringDepth when the input has open boundaries
+    OutOfCoreSubdivision(TriangleSubdivison& scheme, bool moveVertices, int ringDepth, int boundaryRingDepth, int facesPerPatch = 2048);
+
+    // where the patch files go; next to the output file if empty
+    void setWorkDirectory(const std::string& directory);
+    void setThreadPool(ThreadPool* threadPool);
+    bool subdivide(const std::string& inputFile, const std::string& outputFile, int levels);
+
+private:
+    struct Patch {
+        std::vector<int> baseFaces;          // global ids of the core faces
+        std::vector<int> triangles;          // local indices, core faces first, then the halo
+        std::vector<int> globalVertices;     // local -> global vertex index
+        std::vector<float> positions;
+    };
+
+    TriangleSubdivison& scheme;
+    bool moveVertices;
+    int ringDepth;
+    int boundaryRingDepth;
+    int facesPerPatch;
+    std::string workDirectory;
+    ThreadPool* pool;
+    std::mutex outputMutex;
+
+    std::vector<uint64_t> baseEdges;         // sorted (min, max) vertex pairs of the base mesh
+    std::vector<int> vertexOwners;           // patch writing the points on a base vertex
+    std::vector<int> edgeOwners;             // patch writing the points on a base edge, by baseEdges index
+    int baseVertexCount = 0;
+    int levels = 0;
+
+    std::vector<std::string> writePatches(const std::vector<float>& positions, const std::vector<int>& triangles, int rings,
+        const std::string& prefix);
+    // false if the scheme could not refine the patch
+    bool processPatch(int patchIndex, const Patch& patch, std::fstream& positionsFile, std::ostream& facesFile);
+    bool ownsVertex(int patchIndex, int64_t index) const;
+
+    int64_t globalVertexIndex(const int lattice[3], const int baseVertices[3], int baseFace) const;
+
+    static void writePatch(const std::string& filename, const Patch& patch);
+    static bool readPatch(const std::string& filename, Patch& patch);
+};
@@ -0,0 +1,134 @@
+#include "SelfTest.h"
+#include "ButterflySubdivision.h"
+#include "LoopSubdivision.h"
+#include "ObjLoader.h"
+#include "OutOfCoreSubdivision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // the largest distance from a point of one set to the nearest point of the other
+    double hausdorffDistance(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        auto oneSided = [](const std::vector<float>& from, const std::vector<float>& to) {
+            double largest = 0.0;
+            for (size_t i = 0; i < from.size(); i += 3) {
+                double nearest = INFINITY;
+                for (size_t j = 0; j < to.size(); j += 3) {
+                    double dx = from[i] - to[j], dy = from[i + 1] - to[j + 1], dz = from[i + 2] - to[j + 2];
+                    nearest = std::min(nearest, dx * dx + dy * dy + dz * dz);
+                }
+                largest = std::max(largest, nearest);
+            }
+            return std::sqrt(largest);
+        };
+        return std::max(oneSided(a, b), oneSided(b, a));
+    }
+
+    bool report(const std::string& name, bool passed, const std::string& detail)
+    {
+        std::cout << (passed ? "passed: " : "FAILED: ") << name << " (" << detail << ")" << std::endl;
+        return passed;
+    }
+}
+
+bool SelfTest::run(const std::string& workDirectory)
+{
+    bool passed = true;
+    passed &= outOfCoreMatchesInCore(workDirectory);
+    passed &= loadsObjComments(workDirectory);
+    return passed;
+}
+
+bool SelfTest::outOfCoreMatchesInCore(const std::string& workDirectory)
+{
+    // a wavy open grid, so the boundary rings of the stencils are exercised
+    const int n = 24;
+    std::vector<float> positions;
+    std::vector<int> triangles;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            positions.insert(positions.end(), { i / float(n), j / float(n), 0.1f * std::sin(i * 0.9f) * std::cos(j * 0.7f) });
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            int a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+            triangles.insert(triangles.end(), { a, b, d, a, d, c });
+        }
+    }
+    TriangleMesh base(positions, triangles);
+
+    std::string inputFile = workDirectory + "/selftest_grid.obj";
+    if (!saveOBJ(inputFile, base))
+        return report("out-of-core", false, "could not write " + inputFile);
+
+    // subdivides the grid file out-of-core, empty positions if it fails
+    auto runOutOfCore = [&](TriangleSubdivison& scheme, bool moveVertices, int ringDepth, int boundaryRingDepth, int facesPerPatch, int levels) {
+        std::string outputFile = workDirectory + "/selftest_grid_out.obj";
+        OutOfCoreSubdivision outOfCore(scheme, moveVertices, ringDepth, boundaryRingDepth, facesPerPatch);
+        MeshArrays patched;
+        if (outOfCore.subdivide(inputFile, outputFile, levels))
+            loadOBJ(outputFile, patched);
+        std::remove(outputFile.c_str());
+        return patched.positions;
+    };
+
+    LoopSubdivision loop;
+    ButterflySubdivision butterfly;
+    struct Case {
+        const char* name;
+        TriangleSubdivison& scheme;
+        bool moveVertices;
+        int ringDepth;
+        int boundaryRingDepth;
+    };
+    const Case cases[] = { { "Loop", loop, true, 1, 1 }, { "Butterfly", butterfly, false, 2, 3 } };
+
+    // one level has the thinnest halo
+    bool passed = true;
+    for (const Case& test : cases) {
+        for (int levels = 1; levels <= 2; ++levels) {
+            std::vector<float> patched = runOutOfCore(test.scheme, test.moveVertices, test.ringDepth, test.boundaryRingDepth, 16, levels);
+            // a seam point has the same bits in every patch, so the patch size does not matter
+            std::vector<float> whole = runOutOfCore(test.scheme, test.moveVertices, test.ringDepth, test.boundaryRingDepth, base.faceCount(), levels);
+
+            TriangleMesh grid = base;
+            for (int level = 0; level < levels; ++level) test.scheme.subdivide(grid, test.moveVertices);
+            double distance = hausdorffDistance(patched, grid.positions);
+
+            std::ostringstream detail;
+            detail << "level " << levels << ", " << patched.size() / 3 << " of " << grid.vertexCount() << " vertices, "
+                << (patched == whole ? "same as one patch" : "DIFFERS from one patch") << ", Hausdorff distance " << distance;
+            passed &= report(std::string("out-of-core ") + test.name,
+                patched.size() == grid.positions.size() && patched == whole && distance < 1e-5, detail.str());
+        }
+    }
+    std::remove(inputFile.c_str());
+    return passed;
+}
+
+bool SelfTest::loadsObjComments(const std::string& workDirectory)
+{
+    // run from the source directory, where the samples are
+    MeshArrays house;
+    loadOBJ("house_with_roof.obj", house);
+    std::ostringstream detail;
+    detail << house.vertexCount() << " vertices, " << house.faceCount() << " faces";
+    bool passed = report("OBJ with comments", house.vertexCount() == 9 && house.faceCount() == 12, detail.str());
+
+    std::string brokenFile = workDirectory + "/selftest_broken.obj";
+    {
+        std::ofstream broken(brokenFile);
+        broken << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3 # fine\nf 1 two 3\n";
+    }
+    MeshArrays refused;
+    loadOBJ(brokenFile, refused);
+    std::remove(brokenFile.c_str());
+    return report("OBJ with a corner that is not a number", refused.faceCount() == 0, refused.faceCount() == 0 ? "refused" : "loaded") && passed;
+}
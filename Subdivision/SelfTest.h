@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+
+// Checks of the command line paths against each other, run by --self-test. Each check prints
+// one line and run() returns false if any of them failed. Temporary files go to workDirectory.
+class SelfTest
+{
+public:
+    static bool run(const std::string& workDirectory);
+
+    // Loop and Butterfly on an open grid cut into small patches, against one patch bit for bit
+    // and against subdividing it in memory
+    static bool outOfCoreMatchesInCore(const std::string& workDirectory);
+    // the sample house_with_roof.obj has comments after its faces, a corner that is not a number is refused
+    static bool loadsObjComments(const std::string& workDirectory);
+};
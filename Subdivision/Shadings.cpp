@@ -79,7 +79,7 @@ void Shadings::flatShading(Face* f) {
 }
 
 void Shadings::gouraudShading(Vertex* v, Mesh* mesh) {
-    float* vertexNorms = vertexNormals[v];
+    const std::array<float, 3>& vertexNorms = mesh->vertexNormals[v];
 
     // Set the normal for the vertex
     glNormal3f(vertexNorms[0], vertexNorms[1], vertexNorms[2]);
@@ -92,23 +92,32 @@ void Shadings::calculateNormals(Mesh* mesh)
     // calculate every face normal
     for (Face* face : mesh->faces) {
         std::array<float, 3> fnorms = calculateFaceNormal(face);
-        faceNormals[face][0] = fnorms[0];
-        faceNormals[face][1] = fnorms[1];
-        faceNormals[face][2] = fnorms[2];
+        mesh->faceNormals[face] = fnorms;
     }
 
     // calculate every vertex normal for Gouraud shading
     for (Vertex* vertex : mesh->vertices) {
         std::array<float, 3> vertexNorms = calculateVertexNormal(vertex, mesh);
 
-        vertexNormals[vertex][0] = vertexNorms[0];
-        vertexNormals[vertex][1] = vertexNorms[1];
-        vertexNormals[vertex][2] = vertexNorms[2];
+        mesh->vertexNormals[vertex] = vertexNorms;
     }
 
     std::cout << "recalculated normals" << std::endl;
 }
 
+void Shadings::updateNormalsAround(Vertex* v, Mesh* mesh)
+{
+    for (HalfEdge* hfe : v->outgoing()) {
+        if (!hfe->isBoundaryEdge())
+            mesh->faceNormals[hfe->incidentFace] = calculateFaceNormal(hfe->incidentFace);
+    }
+
+    mesh->vertexNormals[v] = calculateVertexNormal(v, mesh);
+    for (Vertex* neighbor : v->oneRing()) {
+        mesh->vertexNormals[neighbor] = calculateVertexNormal(neighbor, mesh);
+    }
+}
+
 std::array<float, 3> Shadings::calculateFaceNormal(Face* f) {
     HalfEdge* startEdge = f->edge;
 
@@ -116,14 +125,22 @@ std::array<float, 3> Shadings::calculateFaceNormal(Face* f) {
     Vertex* v2 = startEdge->next->origin;
     Vertex* v3 = startEdge->next->next->origin;
 
+    const float p1[3] = { v1->x, v1->y, v1->z };
+    const float p2[3] = { v2->x, v2->y, v2->z };
+    const float p3[3] = { v3->x, v3->y, v3->z };
+    return triangleNormal(p1, p2, p3);
+}
+
+std::array<float, 3> Shadings::triangleNormal(const float p1[3], const float p2[3], const float p3[3])
+{
     // Calculate vectors for the triangle edges
-    float ux = v2->x - v1->x;
-    float uy = v2->y - v1->y;
-    float uz = v2->z - v1->z;
+    float ux = p2[0] - p1[0];
+    float uy = p2[1] - p1[1];
+    float uz = p2[2] - p1[2];
 
-    float vx = v3->x - v1->x;
-    float vy = v3->y - v1->y;
-    float vz = v3->z - v1->z;
+    float vx = p3[0] - p1[0];
+    float vy = p3[1] - p1[1];
+    float vz = p3[2] - p1[2];
 
     // Compute the cross product (u  v) to get the normal
     float nx = uy * vz - uz * vy;
@@ -145,27 +162,27 @@ std::array<float, 3> Shadings::calculateVertexNormal(Vertex* v, Mesh* mesh)
 {
     std::array<float, 3> vertexNorms = { 0.0f, 0.0f, 0.0f };
 
-    std::vector<Face*> neighborFaces;
-    for (const auto& hfe : mesh->halfEdges) {
-        if (hfe->origin == v &&
-            (std::find(neighborFaces.begin(), neighborFaces.end(), hfe->incidentFace) == neighborFaces.end())) {
-            neighborFaces.push_back(hfe->incidentFace);
-        }
-    }
+    // every face around the vertex once, the boundary half-edge has no face
+    for (HalfEdge* hfe : v->outgoing()) {
+        if (hfe->isBoundaryEdge())
+            continue;
 
-    for (const auto& neighborFace : neighborFaces) {
-        float* faceNorms = faceNormals[neighborFace];
+        const std::array<float, 3>& faceNorms = mesh->faceNormals[hfe->incidentFace];
         vertexNorms[0] += faceNorms[0];
         vertexNorms[1] += faceNorms[1];
         vertexNorms[2] += faceNorms[2];
     }
 
-    float length = sqrt(vertexNorms[0] * vertexNorms[0] + vertexNorms[1] * vertexNorms[1] + vertexNorms[2] * vertexNorms[2]);
+    normalize(vertexNorms);
+    return vertexNorms;
+}
+
+void Shadings::normalize(std::array<float, 3>& n)
+{
+    float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
     if (length > 0.0f) {
-        vertexNorms[0] /= length;
-        vertexNorms[1] /= length;
-        vertexNorms[2] /= length;
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
     }
-
-    return vertexNorms;
 }
@@ -5,7 +5,6 @@
 #include <iostream>
 
 #include "HalfEdge.h"
-#include "globals.h"
 
 enum ShadingTypes { FLAT, GOURAUD, PHONG, NONE };
 
@@ -17,6 +16,12 @@ public:
 	void static flatShading(Face* f);
 	void static gouraudShading(Vertex* v, Mesh* mesh);
 	void static calculateNormals(Mesh* mesh);
+	// after v moved: the faces around v, v and its neighbors, without recalculating the whole mesh
+	void static updateNormalsAround(Vertex* v, Mesh* mesh);
+	// unit normal of the counter-clockwise triangle p1 p2 p3, the rule calculateNormals uses
+	std::array<float, 3> static triangleNormal(const float p1[3], const float p2[3], const float p3[3]);
+	// a zero vector is left as it is
+	void static normalize(std::array<float, 3>& n);
 private:
 	std::array<float, 3> static calculateFaceNormal(Face* f);
 	std::array<float, 3> static calculateVertexNormal(Vertex* v, Mesh* mesh);
@@ -0,0 +1,432 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <unordered_map>
+
+namespace {
+    const float pi = 3.14159265358979f;
+
+    uint32_t packColor(float r, float g, float b)
+    {
+        auto channel = [](float c) { return static_cast<uint32_t>(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f); };
+        return channel(r) | (channel(g) << 8) | (channel(b) << 16);
+    }
+
+    float unpackChannel(uint32_t color, int channel)
+    {
+        return static_cast<float>((color >> (channel * 8)) & 0xff);
+    }
+
+    void normalize(float v[3])
+    {
+        float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length > 0.0f) {
+            v[0] /= length;
+            v[1] /= length;
+            v[2] /= length;
+        }
+    }
+
+    void faceNormal(const Vertex* a, const Vertex* b, const Vertex* c, float n[3])
+    {
+        float u[3] = { b->x - a->x, b->y - a->y, b->z - a->z };
+        float v[3] = { c->x - a->x, c->y - a->y, c->z - a->z };
+        n[0] = u[1] * v[2] - u[2] * v[1];
+        n[1] = u[2] * v[0] - u[0] * v[2];
+        n[2] = u[0] * v[1] - u[1] * v[0];
+        normalize(n);
+    }
+
+    // same as Shadings: the normalized sum of the unit normals of the faces around the vertex
+    void vertexNormal(const Vertex* v, float n[3])
+    {
+        n[0] = n[1] = n[2] = 0.0f;
+        for (HalfEdge* he : v->outgoing()) {
+            if (he->isBoundaryEdge())
+                continue;
+            float fn[3];
+            faceNormal(he->origin, he->next->origin, he->next->next->origin, fn);
+            n[0] += fn[0];
+            n[1] += fn[1];
+            n[2] += fn[2];
+        }
+        normalize(n);
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0)
+    {
+        // a function-local static is initialized once even when several images are saved at once
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> entries;
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                entries[i] = c;
+            }
+            return entries;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < length; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void writeBigEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> chunk;
+        writeBigEndian(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        writeBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, ThreadPool* pool)
+    : width(width), height(height), pool(pool) {}
+
+void SoftwareRasterizer::setRotation(float angleX, float angleY, float angleZ)
+{
+    angles[0] = angleX;
+    angles[1] = angleY;
+    angles[2] = angleZ;
+}
+
+void SoftwareRasterizer::setPadding(float paddingFactor)
+{
+    this->paddingFactor = paddingFactor;
+}
+
+void SoftwareRasterizer::setColor(float red, float green, float blue)
+{
+    color[0] = red;
+    color[1] = green;
+    color[2] = blue;
+}
+
+void SoftwareRasterizer::render(const Mesh& mesh, ShadingTypes shading)
+{
+    pixels.assign(static_cast<size_t>(width) * height * 3, 255);
+    depth.assign(static_cast<size_t>(width) * height, FLT_MAX);
+    if (mesh.vertices.empty())
+        return;
+
+    // bounding sphere around the box center, as calculateMinMaxMidPoints does
+    float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (const Vertex* v : mesh.vertices) {
+        minPos[0] = std::min(minPos[0], v->x); maxPos[0] = std::max(maxPos[0], v->x);
+        minPos[1] = std::min(minPos[1], v->y); maxPos[1] = std::max(maxPos[1], v->y);
+        minPos[2] = std::min(minPos[2], v->z); maxPos[2] = std::max(maxPos[2], v->z);
+    }
+    float center[3] = { (minPos[0] + maxPos[0]) / 2.0f, (minPos[1] + maxPos[1]) / 2.0f, (minPos[2] + maxPos[2]) / 2.0f };
+    float radius = 0.0f;
+    for (const Vertex* v : mesh.vertices) {
+        float dx = v->x - center[0], dy = v->y - center[1], dz = v->z - center[2];
+        radius = std::max(radius, dx * dx + dy * dy + dz * dz);
+    }
+    radius = std::sqrt(radius);
+    float viewRadius = radius > 0.0f ? radius * (1.0f + paddingFactor) : 1.0f;
+    float scale = std::min(width, height) / (2.0f * viewRadius);
+
+    // modelview of drawScene: translate to the center, rotate around x, y, z, translate back
+    float cx = std::cos(angles[0] * pi / 180.0f), sx = std::sin(angles[0] * pi / 180.0f);
+    float cy = std::cos(angles[1] * pi / 180.0f), sy = std::sin(angles[1] * pi / 180.0f);
+    float cz = std::cos(angles[2] * pi / 180.0f), sz = std::sin(angles[2] * pi / 180.0f);
+    const float rotation[9] = {
+        cy * cz, -cy * sz, sy,
+        sx * sy * cz + cx * sz, -sx * sy * sz + cx * cz, -sx * cy,
+        -cx * sy * cz + sx * sz, cx * sy * sz + sx * cz, cx * cy
+    };
+    auto toEye = [&](float x, float y, float z, float out[3]) {
+        float p[3] = { x - center[0], y - center[1], z - center[2] };
+        for (int k = 0; k < 3; ++k) {
+            out[k] = center[k] + rotation[k * 3] * p[0] + rotation[k * 3 + 1] * p[1] + rotation[k * 3 + 2] * p[2];
+        }
+    };
+    auto rotate = [&](const float n[3], float out[3]) {
+        for (int k = 0; k < 3; ++k) {
+            out[k] = rotation[k * 3] * n[0] + rotation[k * 3 + 1] * n[1] + rotation[k * 3 + 2] * n[2];
+        }
+    };
+
+    // a vertex is shared by several triangles, so its eye space normal is found once up front
+    std::unordered_map<const Vertex*, int> vertexIndex;
+    std::vector<std::array<float, 3>> eyeNormals;
+    if (shading == GOURAUD) {
+        int vertices = static_cast<int>(mesh.vertices.size());
+        vertexIndex.reserve(vertices);
+        for (int v = 0; v < vertices; ++v) vertexIndex[mesh.vertices[v]] = v;
+        eyeNormals.resize(vertices);
+        parallelFor((vertices + facesPerChunk - 1) / facesPerChunk, [&](int block) {
+            int last = std::min(vertices, (block + 1) * facesPerChunk);
+            for (int v = block * facesPerChunk; v < last; ++v) {
+                float n[3];
+                vertexNormal(mesh.vertices[v], n);
+                rotate(n, eyeNormals[v].data());
+            }
+        });
+    }
+
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    int faces = static_cast<int>(mesh.faces.size());
+    std::vector<Chunk> chunks((faces + facesPerChunk - 1) / facesPerChunk);
+
+    // set up and bin the front facing triangles of every chunk
+    parallelFor(static_cast<int>(chunks.size()), [&](int chunkIdx) {
+        Chunk& chunk = chunks[chunkIdx];
+        chunk.bins.assign(tilesX * tilesY, std::vector<uint32_t>());
+        int last = std::min(faces, (chunkIdx + 1) * facesPerChunk);
+
+        for (int f = chunkIdx * facesPerChunk; f < last; ++f) {
+            const Face* face = mesh.faces[f];
+            const Vertex* first = face->edge->origin;
+
+            // polygons are drawn as a fan like GL_POLYGON would
+            for (HalfEdge* he = face->edge->next; he->next != face->edge; he = he->next) {
+                const Vertex* corners[3] = { first, he->origin, he->next->origin };
+                ScreenTriangle tri;
+                float eye[3][3];
+                for (int c = 0; c < 3; ++c) {
+                    toEye(corners[c]->x, corners[c]->y, corners[c]->z, eye[c]);
+                    tri.x[c] = (eye[c][0] - center[0]) * scale + width / 2.0f;
+                    tri.y[c] = height / 2.0f - (eye[c][1] - center[1]) * scale;
+                    tri.z[c] = -eye[c][2];
+                }
+
+                // counter-clockwise on screen is front facing, y points down here
+                float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+                if (area >= 0.0f)
+                    continue;
+
+                float minX = std::min(std::min(tri.x[0], tri.x[1]), tri.x[2]), maxX = std::max(std::max(tri.x[0], tri.x[1]), tri.x[2]);
+                float minY = std::min(std::min(tri.y[0], tri.y[1]), tri.y[2]), maxY = std::max(std::max(tri.y[0], tri.y[1]), tri.y[2]);
+                if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+                    continue;
+
+                if (shading == GOURAUD) {
+                    for (int c = 0; c < 3; ++c) {
+                        tri.color[c] = shade(eyeNormals[vertexIndex.at(corners[c])].data(), eye[c], shading);
+                    }
+                }
+                else {
+                    float n[3], eyeNormal[3];
+                    faceNormal(corners[0], corners[1], corners[2], n);
+                    rotate(n, eyeNormal);
+                    tri.color[0] = tri.color[1] = tri.color[2] = shade(eyeNormal, eye[0], shading);
+                }
+
+                uint32_t triIdx = static_cast<uint32_t>(chunk.triangles.size());
+                chunk.triangles.push_back(tri);
+
+                int tileMinX = std::max(0, static_cast<int>(minX) / tileSize), tileMaxX = std::min(tilesX - 1, static_cast<int>(maxX) / tileSize);
+                int tileMinY = std::max(0, static_cast<int>(minY) / tileSize), tileMaxY = std::min(tilesY - 1, static_cast<int>(maxY) / tileSize);
+                for (int ty = tileMinY; ty <= tileMaxY; ++ty) {
+                    for (int tx = tileMinX; tx <= tileMaxX; ++tx) {
+                        chunk.bins[ty * tilesX + tx].push_back(triIdx);
+                    }
+                }
+            }
+        }
+    });
+
+    // tiles own disjoint pixels, so they need no locking
+    parallelFor(tilesX * tilesY, [&](int tile) {
+        rasterizeTile(tile % tilesX, tile / tilesX, chunks);
+    });
+}
+
+void SoftwareRasterizer::rasterizeTile(int tileX, int tileY, const std::vector<Chunk>& chunks)
+{
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int x0 = tileX * tileSize, y0 = tileY * tileSize;
+    int x1 = std::min(width, x0 + tileSize), y1 = std::min(height, y0 + tileSize);
+
+    for (const Chunk& chunk : chunks) {
+        for (uint32_t triIdx : chunk.bins[tileY * tilesX + tileX]) {
+            const ScreenTriangle& tri = chunk.triangles[triIdx];
+
+            int minX = std::max(x0, static_cast<int>(std::floor(std::min(std::min(tri.x[0], tri.x[1]), tri.x[2]))));
+            int maxX = std::min(x1 - 1, static_cast<int>(std::ceil(std::max(std::max(tri.x[0], tri.x[1]), tri.x[2]))));
+            int minY = std::max(y0, static_cast<int>(std::floor(std::min(std::min(tri.y[0], tri.y[1]), tri.y[2]))));
+            int maxY = std::min(y1 - 1, static_cast<int>(std::ceil(std::max(std::max(tri.y[0], tri.y[1]), tri.y[2]))));
+            if (minX > maxX || minY > maxY)
+                continue;
+
+            // edge functions, weight of corner k is the edge opposite to it
+            float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+            float invArea = 1.0f / area;
+            float stepX[3], stepY[3], rowStart[3];
+            float px = minX + 0.5f, py = minY + 0.5f;
+            for (int k = 0; k < 3; ++k) {
+                int a = (k + 1) % 3, b = (k + 2) % 3;
+                stepX[k] = -(tri.y[b] - tri.y[a]) * invArea;
+                stepY[k] = (tri.x[b] - tri.x[a]) * invArea;
+                rowStart[k] = ((tri.x[b] - tri.x[a]) * (py - tri.y[a]) - (tri.y[b] - tri.y[a]) * (px - tri.x[a])) * invArea;
+            }
+
+            bool flat = tri.color[0] == tri.color[1] && tri.color[1] == tri.color[2];
+            for (int y = minY; y <= maxY; ++y) {
+                float w[3] = { rowStart[0], rowStart[1], rowStart[2] };
+                for (int x = minX; x <= maxX; ++x) {
+                    if (w[0] >= 0.0f && w[1] >= 0.0f && w[2] >= 0.0f) {
+                        size_t pixel = static_cast<size_t>(y) * width + x;
+                        float z = w[0] * tri.z[0] + w[1] * tri.z[1] + w[2] * tri.z[2];
+                        if (z < depth[pixel]) {
+                            depth[pixel] = z;
+                            uint8_t* rgb = &pixels[pixel * 3];
+                            for (int c = 0; c < 3; ++c) {
+                                rgb[c] = flat ? static_cast<uint8_t>(unpackChannel(tri.color[0], c))
+                                    : static_cast<uint8_t>(w[0] * unpackChannel(tri.color[0], c) + w[1] * unpackChannel(tri.color[1], c)
+                                        + w[2] * unpackChannel(tri.color[2], c) + 0.5f);
+                            }
+                        }
+                    }
+                    w[0] += stepX[0]; w[1] += stepX[1]; w[2] += stepX[2];
+                }
+                rowStart[0] += stepY[0]; rowStart[1] += stepY[1]; rowStart[2] += stepY[2];
+            }
+        }
+    }
+}
+
+uint32_t SoftwareRasterizer::shade(const float normal[3], const float eyePos[3], ShadingTypes shading) const
+{
+    // disableLighting leaves only full ambient light, which shows the plain color
+    if (shading == NONE)
+        return packColor(color[0], color[1], color[2]);
+
+    // GL_LIGHT0 defaults to a directional light along +z, global ambient 0.05,
+    // specular 1 with shininess 50 and a local viewer
+    const float globalAmbient = 0.05f;
+    const float lightDir[3] = { 0.0f, 0.0f, 1.0f };
+    float nDotL = normal[0] * lightDir[0] + normal[1] * lightDir[1] + normal[2] * lightDir[2];
+
+    float specular = 0.0f;
+    if (nDotL > 0.0f) {
+        float toViewer[3] = { -eyePos[0], -eyePos[1], -eyePos[2] };
+        normalize(toViewer);
+        float halfway[3] = { lightDir[0] + toViewer[0], lightDir[1] + toViewer[1], lightDir[2] + toViewer[2] };
+        normalize(halfway);
+        float nDotH = std::max(0.0f, normal[0] * halfway[0] + normal[1] * halfway[1] + normal[2] * halfway[2]);
+        specular = std::pow(nDotH, 50.0f);
+    }
+
+    float diffuse = std::max(nDotL, 0.0f);
+    return packColor(color[0] * (globalAmbient + diffuse) + specular,
+        color[1] * (globalAmbient + diffuse) + specular,
+        color[2] * (globalAmbient + diffuse) + specular);
+}
+
+void SoftwareRasterizer::parallelFor(int count, const std::function<void(int)>& body)
+{
+    if (pool == nullptr) {
+        for (int i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    ThreadPool::TaskGroup group;
+    for (int i = 0; i < count; ++i) {
+        pool->submit([&body, i]() { body(i); }, &group);
+    }
+    pool->wait(group);
+}
+
+bool SoftwareRasterizer::save(const std::string& filename) const
+{
+    std::string extension = filename.size() >= 4 ? filename.substr(filename.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".ppm" ? savePPM(filename) : savePNG(filename);
+}
+
+bool SoftwareRasterizer::savePPM(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    return static_cast<bool>(file);
+}
+
+bool SoftwareRasterizer::savePNG(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), 8);
+
+    std::vector<uint8_t> header;
+    writeBigEndian(header, width);
+    writeBigEndian(header, height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // RGB
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    writeChunk(file, "IHDR", header);
+
+    // rows with filter type 0, wrapped into stored deflate blocks, so no zlib is needed
+    std::vector<uint8_t> raw;
+    size_t rowBytes = static_cast<size_t>(width) * 3;
+    raw.reserve((rowBytes + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * rowBytes, pixels.begin() + (y + 1) * rowBytes);
+    }
+
+    std::vector<uint8_t> data = { 0x78, 0x01 };
+    uint32_t adlerA = 1, adlerB = 0;
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535) {
+        size_t length = std::min<size_t>(65535, raw.size() - offset);
+        data.push_back(offset + length >= raw.size() ? 1 : 0);
+        data.push_back(static_cast<uint8_t>(length));
+        data.push_back(static_cast<uint8_t>(length >> 8));
+        data.push_back(static_cast<uint8_t>(~length));
+        data.push_back(static_cast<uint8_t>(~length >> 8));
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+        for (size_t i = offset; i < offset + length; ++i) {
+            adlerA = (adlerA + raw[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        if (raw.empty()) break;
+    }
+    writeBigEndian(data, (adlerB << 16) | adlerA);
+    writeChunk(file, "IDAT", data);
+    writeChunk(file, "IEND", std::vector<uint8_t>());
+
+    return static_cast<bool>(file);
+}
+
+int SoftwareRasterizer::getWidth() const
+{
+    return width;
+}
+
+int SoftwareRasterizer::getHeight() const
+{
+    return height;
+}
+
+const std::vector<uint8_t>& SoftwareRasterizer::getPixels() const
+{
+    return pixels;
+}
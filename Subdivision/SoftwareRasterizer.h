@@ -0,0 +1,61 @@
+#pragma once
+#include "HalfEdge.h"
+#include "Shadings.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Renders a mesh into an RGB image on the CPU, for thumbnails where there is no display or GPU.
+// The camera and the lighting follow the viewer: orthographic view of the bounding sphere with
+// the same padding and rotations, GL_LIGHT0 and material as set up by Shadings::setupLighting,
+// back faces culled. Triangles are set up in chunks and binned into screen tiles, then every
+// tile is rasterized with its own part of the depth buffer as a separate pool task.
+class SoftwareRasterizer
+{
+public:
+    SoftwareRasterizer(int width, int height, ThreadPool* pool = nullptr);
+
+    void setRotation(float angleX, float angleY, float angleZ);
+    void setPadding(float paddingFactor);
+    void setColor(float red, float green, float blue);
+
+    void render(const Mesh& mesh, ShadingTypes shading = FLAT);
+
+    // the format is chosen by the extension, .png or .ppm
+    bool save(const std::string& filename) const;
+    bool savePPM(const std::string& filename) const;
+    bool savePNG(const std::string& filename) const;
+
+    int getWidth() const;
+    int getHeight() const;
+    const std::vector<uint8_t>& getPixels() const;
+
+private:
+    struct ScreenTriangle {
+        float x[3], y[3], z[3];
+        uint32_t color[3];
+    };
+
+    struct Chunk {
+        std::vector<ScreenTriangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    static const int tileSize = 64;
+    static const int facesPerChunk = 32768;
+
+    int width, height;
+    ThreadPool* pool;
+    float angles[3] = { 0.0f, 0.0f, 0.0f };
+    float paddingFactor = 0.2f;
+    float color[3] = { 1.0f, 0.0f, 0.0f };
+
+    std::vector<uint8_t> pixels;
+    std::vector<float> depth;
+
+    void parallelFor(int count, const std::function<void(int)>& body);
+    uint32_t shade(const float normal[3], const float eyePos[3], ShadingTypes shading) const;
+    void rasterizeTile(int tileX, int tileY, const std::vector<Chunk>& chunks);
+};
@@ -0,0 +1,258 @@
+#include "Sqrt3Subdivision.h"
+
+#include <cmath>
+#include <memory>
+
+float sqrt3Alpha(int n)
+{
+    return (4.0f - 2.0f * std::cos(2.0f * 3.14159265f / n)) / 9.0f;
+}
+
+Sqrt3Subdivision::Sqrt3Subdivision(int level) : level(level) {}
+
+void Sqrt3Subdivision::setLevel(int level)
+{
+    this->level = level;
+}
+
+int Sqrt3Subdivision::getLevel() const
+{
+    return level;
+}
+
+size_t Sqrt3Subdivision::predictPeakBytes(const TriangleMesh& mesh, int levels) const
+{
+    size_t vertices = mesh.vertexCount(), faceCount = mesh.faceCount(), boundaries = mesh.boundaryCount();
+    size_t peak = mesh.memoryUsage();
+    for (int i = 0; i < levels; ++i) {
+        bool trisect = (level + i) % 2 == 1;
+        size_t nextVertices = vertices + faceCount + (trisect ? boundaries * 2 : 0);
+        size_t nextFaces = faceCount * 3 + (trisect ? boundaries * 2 : 0);
+        size_t nextBoundaries = trisect ? boundaries * 3 : boundaries;
+        // both levels, the triangle list, the positions it is built from and the boundary links
+        size_t levelPeak = TriangleMesh::bytesFor(vertices, faceCount, boundaries) + TriangleMesh::bytesFor(nextVertices, nextFaces, nextBoundaries)
+            + nextFaces * 3 * sizeof(int) + nextVertices * 3 * sizeof(float) + boundaries * sizeof(int);
+        peak = std::max(peak, levelPeak);
+        vertices = nextVertices;
+        faceCount = nextFaces;
+        boundaries = nextBoundaries;
+    }
+    return peak;
+}
+
+bool Sqrt3Subdivision::subdivide(Mesh* mesh, bool moveVertices)
+{
+    std::cout << "starting sqrt3 subdivision process" << std::endl;
+
+    LevelEstimate estimate = MemoryEstimate::nextSqrt3(MemoryEstimate::current(*mesh), trisectsBoundary());
+    budgetExceeded = memoryBudget > 0 && estimate.peakBytes > memoryBudget;
+    peakBytes = 0;
+    if (budgetExceeded) {
+        std::cout << "refusing subdivison: the next level needs about " << MemoryEstimate::formatBytes(estimate.peakBytes)
+            << ", the budget is " << MemoryEstimate::formatBytes(memoryBudget) << std::endl << std::endl;
+        return false;
+    }
+    if (!mesh->channels.empty())
+        std::cout << "dropping " << mesh->channels.size() << " attribute channels, sqrt3 does not refine them" << std::endl;
+
+    // the level is built on the directed-edge form and converted back
+    TriangleMesh fine;
+    {
+        TriangleMesh coarse(*mesh);
+        if (!refine(coarse, fine, moveVertices)) {
+            std::cout << "cancelled subdivison process" << std::endl << std::endl;
+            return false;
+        }
+        peakBytes += mesh->memoryUsage();
+    }
+    std::cout << "built new faces" << std::endl;
+
+    std::unique_ptr<Mesh> result(fine.toMesh(pool));
+    peakBytes = std::max(peakBytes, mesh->memoryUsage() + fine.memoryUsage() + result->memoryUsage());
+
+    // the result takes over the elements of the previous level and releases them
+    std::swap(mesh->vertices, result->vertices);
+    std::swap(mesh->halfEdges, result->halfEdges);
+    std::swap(mesh->faces, result->faces);
+    std::swap(mesh->vertexNameIdx, result->vertexNameIdx);
+    std::swap(mesh->faceNameIdx, result->faceNameIdx);
+    std::swap(mesh->halfEdgeNameIdx, result->halfEdgeNameIdx);
+    mesh->vertexNormals.clear();
+    mesh->faceNormals.clear();
+    mesh->channels.clear();
+    result.reset();
+
+    Shadings::calculateNormals(mesh);
+    reportProgress(1.0f);
+    level++;
+
+    peakBytes = std::max(peakBytes, mesh->memoryUsage());
+    std::cout << "peak memory " << MemoryEstimate::formatBytes(peakBytes)
+        << " (predicted " << MemoryEstimate::formatBytes(estimate.peakBytes) << ")" << std::endl;
+    std::cout << "finished subdivison process" << std::endl << std::endl;
+    return true;
+}
+
+bool Sqrt3Subdivision::subdivide(TriangleMesh& mesh, bool moveVertices)
+{
+    std::cout << "starting sqrt3 subdivision process" << std::endl;
+
+    size_t predictedPeakBytes = predictPeakBytes(mesh, 1);
+    budgetExceeded = memoryBudget > 0 && predictedPeakBytes > memoryBudget;
+    peakBytes = 0;
+    if (budgetExceeded) {
+        std::cout << "refusing subdivison: the next level needs about " << MemoryEstimate::formatBytes(predictedPeakBytes)
+            << ", the budget is " << MemoryEstimate::formatBytes(memoryBudget) << std::endl << std::endl;
+        return false;
+    }
+
+    TriangleMesh fine;
+    if (!refine(mesh, fine, moveVertices)) {
+        std::cout << "cancelled subdivison process" << std::endl << std::endl;
+        return false;
+    }
+    std::cout << "built new faces" << std::endl;
+    peakBytes = std::max(peakBytes, mesh.memoryUsage() + fine.memoryUsage());
+
+    mesh = std::move(fine);
+    reportProgress(1.0f);
+    level++;
+
+    std::cout << "peak memory " << MemoryEstimate::formatBytes(peakBytes)
+        << " (predicted " << MemoryEstimate::formatBytes(predictedPeakBytes) << ")" << std::endl;
+    std::cout << "finished subdivison process" << std::endl << std::endl;
+    return true;
+}
+
+bool Sqrt3Subdivision::refine(const TriangleMesh& coarse, TriangleMesh& fine, bool moveVertices)
+{
+    const float* positions = coarse.positions.data();
+    int vertices = coarse.vertexCount();
+    int faces = coarse.faceCount();
+    int halfEdges = faces * 3;
+    int boundaries = coarse.boundaryCount();
+    bool trisect = trisectsBoundary();
+
+    // fine vertices: the old ones, one per face, then two per boundary edge on trisecting levels
+    int centers = vertices;
+    int edgePoints = vertices + faces;
+    int fineVertices = edgePoints + (trisect ? boundaries * 2 : 0);
+    std::vector<float> finePositions(static_cast<size_t>(fineVertices) * 3);
+    std::copy(coarse.positions.begin(), coarse.positions.end(), finePositions.begin());
+
+    // the boundary half-edge before each one, boundaryNext only links forward
+    std::vector<int> boundaryPrev(boundaries, -1);
+    for (int i = 0; i < boundaries; ++i) {
+        if (coarse.boundaryNext[i] >= 0)
+            boundaryPrev[coarse.boundaryNext[i] - halfEdges] = halfEdges + i;
+    }
+    // the other end of a boundary half-edge's neighbour, or v itself on an open chain
+    auto boundaryNeighbor = [&](int he, int v) { return he < 0 ? v : coarse.origin(he) == v ? coarse.origin(coarse.twin(he)) : coarse.origin(he); };
+
+    size_t total = static_cast<size_t>(faces) + (moveVertices ? vertices : 0) + (trisect ? boundaries : 0);
+    size_t processed = 0;
+    auto progress = [&]() { return ++processed % progressStep != 0 || reportProgress(0.8f * processed / total); };
+
+    IndexStencil stencil;
+    for (int f = 0; f < faces; ++f) {
+        stencil.clear();
+        for (int k = 0; k < 3; ++k) stencil.add(coarse.origin(f * 3 + k), 1.0f / 3.0f);
+        stencil.place(positions, &finePositions[static_cast<size_t>(centers + f) * 3]);
+        if (stencilTable)
+            stencilTable->addRow(centers + f, stencil);
+        if (!progress())
+            return false;
+    }
+
+    if (moveVertices) {
+        for (int v = 0; v < vertices; ++v) {
+            int out = coarse.outgoing(v);
+            if (out < 0)
+                continue;
+            stencil.clear();
+            if (!coarse.isBoundary(out)) {
+                int n = coarse.valence(v);
+                float alpha = sqrt3Alpha(n);
+                stencil.add(v, 1.0f - alpha);
+                for (int neighbor : coarse.oneRing(v)) stencil.add(neighbor, alpha / n);
+            }
+            else if (trisect) {
+                // the boundary only moves on the levels that refine it
+                stencil.add(boundaryNeighbor(boundaryPrev[out - halfEdges], v), 4.0f / 27.0f);
+                stencil.add(v, 19.0f / 27.0f);
+                stencil.add(coarse.origin(coarse.twin(out)), 4.0f / 27.0f);
+            }
+            else {
+                continue;
+            }
+            stencil.place(positions, &finePositions[static_cast<size_t>(v) * 3]);
+            if (stencilTable)
+                stencilTable->addRow(v, stencil);
+            if (!progress())
+                return false;
+        }
+    }
+
+    if (trisect) {
+        for (int i = 0; i < boundaries; ++i) {
+            // boundary half-edge b runs from b1 to b0 against its face, a point is placed near each end
+            int b = halfEdges + i;
+            int b1 = coarse.origin(b);
+            int b0 = coarse.origin(coarse.twin(b));
+            int after = boundaryNeighbor(coarse.boundaryNext[i], b0);
+            int before = boundaryNeighbor(boundaryPrev[i], b1);
+
+            stencil.clear();
+            stencil.add(after, 1.0f / 27.0f);
+            stencil.add(b0, 16.0f / 27.0f);
+            stencil.add(b1, 10.0f / 27.0f);
+            stencil.place(positions, &finePositions[static_cast<size_t>(edgePoints + i * 2) * 3]);
+            if (stencilTable)
+                stencilTable->addRow(edgePoints + i * 2, stencil);
+
+            stencil.clear();
+            stencil.add(b0, 10.0f / 27.0f);
+            stencil.add(b1, 16.0f / 27.0f);
+            stencil.add(before, 1.0f / 27.0f);
+            stencil.place(positions, &finePositions[static_cast<size_t>(edgePoints + i * 2 + 1) * 3]);
+            if (stencilTable)
+                stencilTable->addRow(edgePoints + i * 2 + 1, stencil);
+            if (!progress())
+                return false;
+        }
+    }
+
+    // Face half-edge h from a to b gives the triangle (a, center across h, own center), which
+    // together with the one of its twin replaces the edge by the flipped one between the centers.
+    // A boundary half-edge keeps its edge in (a, b, center), or on trisecting levels is split
+    // into (a, p0, center) (p0, p1, center) (p1, b, center), the extra two after all others.
+    std::vector<int> triangles;
+    triangles.reserve((static_cast<size_t>(halfEdges) + (trisect ? boundaries * 2 : 0)) * 3);
+    for (int h = 0; h < halfEdges; ++h) {
+        int twin = coarse.twin(h);
+        int center = centers + h / 3;
+        triangles.push_back(coarse.origin(h));
+        if (!coarse.isBoundary(twin))
+            triangles.push_back(centers + twin / 3);
+        else if (!trisect)
+            triangles.push_back(coarse.origin(coarse.next(h)));
+        else
+            triangles.push_back(edgePoints + (twin - halfEdges) * 2);
+        triangles.push_back(center);
+    }
+    if (trisect) {
+        for (int i = 0; i < boundaries; ++i) {
+            int center = centers + coarse.twin(halfEdges + i) / 3;
+            int p0 = edgePoints + i * 2;
+            int p1 = p0 + 1;
+            triangles.insert(triangles.end(), { p0, p1, center, p1, coarse.origin(halfEdges + i), center });
+        }
+    }
+    if (!reportProgress(0.8f))
+        return false;
+
+    fine = TriangleMesh(finePositions, triangles);
+    peakBytes = coarse.memoryUsage() + fine.memoryUsage() + triangles.capacity() * sizeof(int)
+        + finePositions.capacity() * sizeof(float) + boundaryPrev.capacity() * sizeof(int);
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+// based on: Kobbelt, "sqrt(3)-Subdivision", SIGGRAPH 2000
+
+#include "TriangleSubdivison.h"
+
+// weight of the one-ring when relaxing a vertex of valence n, (4 - 2 cos(2 pi / n)) / 9
+float sqrt3Alpha(int n);
+
+// Kobbelt's sqrt(3) scheme. Every face gets a vertex at its center, the old vertices are relaxed
+// towards their one-ring and every interior edge is flipped to join the two centers beside it,
+// so a level has three times the faces of the previous one instead of four. The triangles are
+// rotated by 30 degrees each level, two levels refine every edge in three.
+// Boundary edges are not flipped; on every second level they are cut in three by the ternary
+// cubic B-spline rule (1 16 10) / 27, which also moves the old boundary vertices by (4 19 4) / 27.
+// The level of a mesh decides whether its boundary is cut, so an object follows one mesh level
+// by level, starting at the level given to the constructor or setLevel.
+// Polygons are split into triangle fans first. Attribute channels are not carried through.
+class Sqrt3Subdivision : public TriangleSubdivison
+{
+public:
+    explicit Sqrt3Subdivision(int level = 0);
+
+    bool subdivide(Mesh* mesh, bool moveVertices) override;
+    bool subdivide(TriangleMesh& mesh, bool moveVertices) override;
+
+    // a level is not a split in four, so there is no out-of-core or streaming path
+    bool splitsInFour() const override { return false; }
+
+    void setLevel(int level) override;
+    int getLevel() const;
+    // the largest footprint while the given number of levels are built from mesh
+    size_t predictPeakBytes(const TriangleMesh& mesh, int levels) const;
+
+private:
+    int level;
+
+    bool trisectsBoundary() const { return level % 2 == 1; }
+    // builds the next level in fine, false if cancelled
+    bool refine(const TriangleMesh& coarse, TriangleMesh& fine, bool moveVertices);
+
+    // the scheme replaces the whole level, the hooks of the split in four are never called:
+    // subdivide is overridden and refinePatch checks splitsInFour first
+    bool createEdgeVertices(Mesh*, std::unordered_map<HalfEdge*, Vertex*>&) override { return false; }
+    bool moveOldVertices(Mesh*, std::vector<Vertex*>&) override { return false; }
+    bool placeVertices(const TriangleMesh&, TriangleMesh&, const std::vector<int>&, bool, bool) override { return false; }
+    void placeFaceVertices(const TriangleMesh&, int, bool, float[18]) override {}
+};
@@ -0,0 +1,210 @@
+#include "StreamingSubdivision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+StreamingSubdivision::StreamingSubdivision(TriangleSubdivison& scheme, bool moveVertices, int ringDepth)
+    : scheme(scheme), moveVertices(moveVertices), ringDepth(std::max(1, ringDepth)) {}
+
+size_t StreamingSubdivision::getPeakBytes() const
+{
+    return peakBytes;
+}
+
+size_t StreamingSubdivision::subdivide(const TriangleMesh& base, int levels, const TriangleSink& sink)
+{
+    if (levels > 0 && !scheme.splitsInFour()) {
+        std::cerr << "Streaming subdivision needs a scheme that splits every face in four" << std::endl;
+        return 0;
+    }
+
+    faceStamps.assign(base.faceCount(), 0);
+    vertexStamps.assign(base.vertexCount(), 0);
+    indexStamps.assign(base.vertexCount(), 0);
+    localIndex.assign(base.vertexCount(), -1);
+    stamp = 0;
+    size_t baseBytes = base.memoryUsage() + (faceStamps.size() + vertexStamps.size() + indexStamps.size() + localIndex.size()) * 4;
+    peakBytes = baseBytes;
+    size_t emitted = 0;
+
+    for (int f = 0; f < base.faceCount(); ++f) {
+        if (levels < 1) {
+            emitFace(base, f, sink);
+            emitted++;
+            continue;
+        }
+
+        TriangleMesh patch;
+        extractPatch(base, f, patch);
+        size_t stackBytes = baseBytes + patch.memoryUsage();
+        peakBytes = std::max(peakBytes, stackBytes);
+        emitted += refineFace(patch, levels, stackBytes, sink);
+    }
+
+    return emitted;
+}
+
+size_t StreamingSubdivision::refineFace(const TriangleMesh& patch, int levels, size_t stackBytes, const TriangleSink& sink)
+{
+    // the last level needs the six points of face 0 only, not the whole patch
+    if (levels == 1) {
+        float points[18];
+        if (!scheme.refinePatchFace(patch, 0, moveVertices, points))
+            return 0;
+
+        // the four faces of rebuildFace: (c0 e0 e2) (e0 e1 e2) (e0 c1 e1) (e2 e1 c2)
+        const int children[4][3] = { { 0, 3, 5 }, { 3, 4, 5 }, { 3, 1, 4 }, { 5, 4, 2 } };
+        float corners[9];
+        for (int child = 0; child < 4; ++child) {
+            for (int c = 0; c < 3; ++c) {
+                std::copy(&points[children[child][c] * 3], &points[children[child][c] * 3] + 3, &corners[c * 3]);
+            }
+            sink(corners);
+        }
+        return 4;
+    }
+
+    TriangleMesh fine;
+    if (!scheme.refinePatch(patch, fine, moveVertices))
+        return 0;
+    stackBytes += fine.memoryUsage();
+    peakBytes = std::max(peakBytes, stackBytes);
+
+    // split numbers the children of face 0 as 0..3
+    size_t emitted = 0;
+    for (int child = 0; child < 4; ++child) {
+        TriangleMesh childPatch;
+        extractPatch(fine, child, childPatch);
+        emitted += refineFace(childPatch, levels - 1, stackBytes + childPatch.memoryUsage(), sink);
+    }
+    return emitted;
+}
+
+void StreamingSubdivision::nextStamp(const TriangleMesh& mesh)
+{
+    // a patch refined from a base face is usually smaller than the base mesh, but need not be
+    if (faceStamps.size() < static_cast<size_t>(mesh.faceCount()))
+        faceStamps.resize(mesh.faceCount(), 0);
+    if (vertexStamps.size() < static_cast<size_t>(mesh.vertexCount())) {
+        vertexStamps.resize(mesh.vertexCount(), 0);
+        indexStamps.resize(mesh.vertexCount(), 0);
+        localIndex.resize(mesh.vertexCount(), -1);
+    }
+    if (++stamp == 0) {
+        std::fill(faceStamps.begin(), faceStamps.end(), 0);
+        std::fill(vertexStamps.begin(), vertexStamps.end(), 0);
+        std::fill(indexStamps.begin(), indexStamps.end(), 0);
+        stamp = 1;
+    }
+}
+
+void StreamingSubdivision::extractPatch(const TriangleMesh& mesh, int face, TriangleMesh& patch)
+{
+    nextStamp(mesh);
+    std::vector<int> faces = { face };
+    faceStamps[face] = stamp;
+
+    // every ring adds the faces around the vertices of the previous one
+    size_t ringStart = 0;
+    for (int ring = 0; ring < ringDepth; ++ring) {
+        size_t ringEnd = faces.size();
+        for (size_t i = ringStart; i < ringEnd; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                int v = mesh.origin(faces[i] * 3 + c);
+                if (vertexStamps[v] == stamp)
+                    continue;
+                vertexStamps[v] = stamp;
+
+                int start = mesh.outgoing(v);
+                for (int he = start; he >= 0;) {
+                    if (!mesh.isBoundary(he) && faceStamps[he / 3] != stamp) {
+                        faceStamps[he / 3] = stamp;
+                        faces.push_back(he / 3);
+                    }
+                    he = mesh.next(mesh.twin(he));
+                    if (he == start) break;
+                }
+            }
+        }
+        ringStart = ringEnd;
+    }
+
+    std::vector<float> positions;
+    std::vector<int> triangles;
+    triangles.reserve(faces.size() * 3);
+    for (int f : faces) {
+        for (int c = 0; c < 3; ++c) {
+            int v = mesh.origin(f * 3 + c);
+            if (indexStamps[v] != stamp) {
+                indexStamps[v] = stamp;
+                localIndex[v] = static_cast<int>(positions.size() / 3);
+                positions.insert(positions.end(), &mesh.positions[v * 3], &mesh.positions[v * 3] + 3);
+            }
+            triangles.push_back(localIndex[v]);
+        }
+    }
+
+    patch = TriangleMesh(std::move(positions), triangles);
+}
+
+void StreamingSubdivision::emitFace(const TriangleMesh& mesh, int face, const TriangleSink& sink)
+{
+    float corners[9];
+    for (int c = 0; c < 3; ++c) {
+        const float* p = &mesh.positions[mesh.origin(face * 3 + c) * 3];
+        corners[c * 3] = p[0];
+        corners[c * 3 + 1] = p[1];
+        corners[c * 3 + 2] = p[2];
+    }
+    sink(corners);
+}
+
+bool StreamingSubdivision::subdivideToSTL(const TriangleMesh& base, int levels, const std::string& filename)
+{
+    if (levels > 0 && !scheme.splitsInFour()) {
+        std::cerr << "Streaming subdivision needs a scheme that splits every face in four" << std::endl;
+        return false;
+    }
+
+    std::ofstream stlFile(filename, std::ios::binary);
+    if (!stlFile.is_open()) {
+        std::cerr << "Could not open the file: " << filename << std::endl;
+        return false;
+    }
+
+    // 80 byte header and the triangle count, which is filled in at the end
+    char header[80] = "binary STL written by StreamingSubdivision";
+    uint32_t count = 0;
+    stlFile.write(header, sizeof(header));
+    stlFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    size_t emitted = subdivide(base, levels, [&stlFile](const float corners[9]) {
+        // normal, three corners and an unused attribute word, all little endian
+        float u[3] = { corners[3] - corners[0], corners[4] - corners[1], corners[5] - corners[2] };
+        float v[3] = { corners[6] - corners[0], corners[7] - corners[1], corners[8] - corners[2] };
+        float n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f) {
+            n[0] /= length; n[1] /= length; n[2] /= length;
+        }
+        uint16_t attribute = 0;
+        stlFile.write(reinterpret_cast<const char*>(n), sizeof(n));
+        stlFile.write(reinterpret_cast<const char*>(corners), sizeof(float) * 9);
+        stlFile.write(reinterpret_cast<const char*>(&attribute), sizeof(attribute));
+    });
+
+    if (emitted > UINT32_MAX) {
+        std::cerr << "Too many triangles for STL: " << emitted << std::endl;
+        return false;
+    }
+    count = static_cast<uint32_t>(emitted);
+    stlFile.seekp(sizeof(header));
+    stlFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    std::cout << "streamed " << emitted << " triangles to " << filename << ", peak memory "
+        << MemoryEstimate::formatBytes(peakBytes) << std::endl;
+    return static_cast<bool>(stlFile);
+}
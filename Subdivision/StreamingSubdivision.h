@@ -0,0 +1,54 @@
+#pragma once
+#include "TriangleMesh.h"
+#include "TriangleSubdivison.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Writes deep levels without building them. Every base face is refined depth-first: the face and
+// ringDepth rings of faces around it are cut out as a small patch and split once, then each of
+// the four children is cut out with its own rings from the result and refined further, down to
+// the requested level. Only one patch per level is alive, so memory follows the base mesh.
+// Loop needs one ring around a face. The wings of the Butterfly stencil need two, or three on
+// meshes with open boundaries, where they run along the boundary. The stencils of a patch are
+// summed in position order, so points shared by neighbouring faces are bit-identical.
+// Triangles come out in base face order, the children of a face in the order of rebuildFace.
+class StreamingSubdivision
+{
+public:
+    // receives the three corners of a triangle as x, y, z triples
+    typedef std::function<void(const float corners[9])> TriangleSink;
+
+    StreamingSubdivision(TriangleSubdivison& scheme, bool moveVertices, int ringDepth);
+
+    // returns the number of triangles passed to sink
+    size_t subdivide(const TriangleMesh& base, int levels, const TriangleSink& sink);
+    // writes a binary STL; false if the file cannot be written
+    bool subdivideToSTL(const TriangleMesh& base, int levels, const std::string& filename);
+
+    // the largest total of the patches alive at once during the last run
+    size_t getPeakBytes() const;
+
+private:
+    TriangleSubdivison& scheme;
+    bool moveVertices;
+    int ringDepth;
+    size_t peakBytes = 0;
+
+    // Marks for extractPatch, sized once per run. An entry counts only if it holds the current
+    // stamp, so a patch costs its own size and not that of the mesh it is cut from.
+    std::vector<uint32_t> faceStamps;
+    std::vector<uint32_t> vertexStamps;
+    std::vector<uint32_t> indexStamps;
+    std::vector<int> localIndex;
+    uint32_t stamp = 0;
+
+    // the face comes first in the patch, followed by ringDepth rings of faces around it
+    void extractPatch(const TriangleMesh& mesh, int face, TriangleMesh& patch);
+    void nextStamp(const TriangleMesh& mesh);
+    // refines face 0 of patch, stackBytes counts the patches of the coarser levels
+    size_t refineFace(const TriangleMesh& patch, int levels, size_t stackBytes, const TriangleSink& sink);
+    static void emitFace(const TriangleMesh& mesh, int face, const TriangleSink& sink);
+};
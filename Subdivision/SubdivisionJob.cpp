@@ -0,0 +1,74 @@
+#include "SubdivisionJob.h"
+#include "MeshReorder.h"
+
+SubdivisionJob::SubdivisionJob(const Mesh* source, std::unique_ptr<TriangleSubdivison> scheme, bool moveVertices, int levels, bool reorder)
+    : scheme(std::move(scheme)), moveVertices(moveVertices), levels(levels), reorder(reorder)
+{
+    // copied on the calling thread, the caller may replace its mesh as soon as this returns
+    result = source->clone();
+    worker = std::thread(&SubdivisionJob::run, this);
+}
+
+SubdivisionJob::~SubdivisionJob()
+{
+    cancel();
+    join();
+    delete result;
+}
+
+void SubdivisionJob::cancel()
+{
+    cancelled = true;
+}
+
+void SubdivisionJob::join()
+{
+    if (worker.joinable())
+        worker.join();
+}
+
+bool SubdivisionJob::isFinished() const
+{
+    return finished;
+}
+
+bool SubdivisionJob::wasCancelled() const
+{
+    return cancelled;
+}
+
+float SubdivisionJob::getProgress() const
+{
+    return progress;
+}
+
+Mesh* SubdivisionJob::takeResult()
+{
+    join();
+    if (cancelled)
+        return nullptr;
+
+    Mesh* mesh = result;
+    result = nullptr;
+    return mesh;
+}
+
+void SubdivisionJob::run()
+{
+    for (int level = 0; level < levels && !cancelled; ++level) {
+        scheme->setProgressCallback([this, level](float fraction) {
+            progress = (level + fraction) / levels;
+            return !cancelled;
+        });
+
+        if (!scheme->subdivide(result, moveVertices)) {
+            cancelled = true;
+            break;
+        }
+        if (reorder && !cancelled)
+            MeshReorder::reorder(result);
+    }
+
+    progress = 1.0f;
+    finished = true;
+}
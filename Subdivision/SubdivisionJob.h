@@ -0,0 +1,43 @@
+#pragma once
+#include "TriangleSubdivison.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Subdivides a copy of a mesh on a background thread, so the GLUT thread keeps drawing.
+// The source mesh is only read while the job starts, the result is handed over with takeResult()
+// once isFinished() is true. A cancelled job throws its partial work away.
+class SubdivisionJob
+{
+public:
+    SubdivisionJob(const Mesh* source, std::unique_ptr<TriangleSubdivison> scheme, bool moveVertices, int levels, bool reorder);
+    ~SubdivisionJob();
+
+    SubdivisionJob(const SubdivisionJob&) = delete;
+    SubdivisionJob& operator=(const SubdivisionJob&) = delete;
+
+    void cancel();
+    void join();
+
+    bool isFinished() const;
+    bool wasCancelled() const;
+    float getProgress() const;
+
+    // the subdivided mesh, nullptr if the job was cancelled or the result was already taken
+    Mesh* takeResult();
+
+private:
+    std::unique_ptr<TriangleSubdivison> scheme;
+    bool moveVertices;
+    int levels;
+    bool reorder;
+
+    Mesh* result = nullptr;
+    std::atomic<bool> finished{ false };
+    std::atomic<bool> cancelled{ false };
+    std::atomic<float> progress{ 0.0f };
+    std::thread worker;
+
+    void run();
+};
@@ -0,0 +1,352 @@
+#include "SubdivisionServer.h"
+#include "ButterflySubdivision.h"
+#include "LoopSubdivision.h"
+#include "Sqrt3Subdivision.h"
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+namespace {
+    const uint32_t resultMagic = 0x52564453;    // "SDVR"
+    const uint32_t resultVersion = 1;
+    const size_t resultHeaderBytes = 4 * sizeof(uint32_t);
+
+    // guards the allocations against garbage headers
+    const uint32_t maxElements = 1u << 28;
+
+    struct Reply {
+        uint32_t status;
+        uint32_t length;
+    };
+
+    // FNV-1a, 64 bit
+    void hashBytes(uint64_t& hash, const void* data, size_t bytes)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+    }
+}
+
+SubdivisionServer::SubdivisionServer(const std::string& cacheDirectory, size_t budgetBytes, int threadCount)
+    : pool(threadCount), cacheDirectory(cacheDirectory), budgetBytes(budgetBytes) {}
+
+uint64_t SubdivisionServer::contentHash(uint32_t scheme, uint32_t levels, const std::vector<float>& positions, const std::vector<int>& triangles)
+{
+    uint64_t hash = 14695981039346656037ull;
+    uint64_t sizes[2] = { positions.size(), triangles.size() };
+    hashBytes(hash, &scheme, sizeof(scheme));
+    hashBytes(hash, &levels, sizeof(levels));
+    hashBytes(hash, sizes, sizeof(sizes));
+    hashBytes(hash, positions.data(), positions.size() * sizeof(float));
+    hashBytes(hash, triangles.data(), triangles.size() * sizeof(int));
+    return hash;
+}
+
+std::string SubdivisionServer::resultPath(uint64_t key) const
+{
+    std::stringstream path;
+    path << cacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".mesh";
+    return path.str();
+}
+
+bool SubdivisionServer::run(const std::string& socketPath)
+{
+    LocalSocket listener;
+    if (!listener.listen(socketPath)) {
+        std::cerr << "Could not listen on " << socketPath << std::endl;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        loadIndex();
+    }
+    std::cout << "serving on " << socketPath << ", " << entries.size() << " cached levels" << std::endl;
+
+    ThreadPool::TaskGroup requests;
+    while (listener.isValid()) {
+        LocalSocket connection = listener.accept();
+        SubdivisionRequest request;
+        if (!connection.isValid() || !connection.readAll(&request, sizeof(request)) || request.magic != SubdivisionRequest::magicValue)
+            continue;
+
+        if (request.kind == SubdivisionRequest::SHUTDOWN) {
+            reply(connection, 0, "");
+            break;
+        }
+
+        // the task outlives this iteration, std::function needs something copyable to hold the socket
+        std::shared_ptr<LocalSocket> shared = std::make_shared<LocalSocket>(std::move(connection));
+        pool.submit([this, shared, request]() { serve(*shared, request); }, &requests);
+    }
+
+    pool.wait(requests);
+    listener.close();
+    std::remove(socketPath.c_str());
+    std::cout << "stopped serving" << std::endl;
+    return true;
+}
+
+void SubdivisionServer::serve(LocalSocket& connection, const SubdivisionRequest& request)
+{
+    if (request.kind != SubdivisionRequest::SUBDIVIDE || request.scheme > SubdivisionRequest::SQRT3
+        || request.vertexCount > maxElements || request.triangleCount > maxElements) {
+        reply(connection, 1, "malformed request");
+        return;
+    }
+
+    std::vector<float> positions(static_cast<size_t>(request.vertexCount) * 3);
+    std::vector<int> triangles(static_cast<size_t>(request.triangleCount) * 3);
+    if (!connection.readAll(positions.data(), positions.size() * sizeof(float))
+        || !connection.readAll(triangles.data(), triangles.size() * sizeof(int)))
+        return;
+
+    uint64_t key = contentHash(request.scheme, request.levels, positions, triangles);
+    std::string path = resultPath(key);
+    // a new level is written under a private name first, so a client never maps a half written file
+    std::string temporaryPath;
+    bool cached;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        cached = touch(key);
+        if (!cached)
+            temporaryPath = path + ".tmp" + std::to_string(temporaryCounter++);
+    }
+    if (cached) {
+        reply(connection, 0, path);
+        return;
+    }
+
+    size_t bytes = 0;
+    std::string error;
+    if (!compute(request, positions, triangles, temporaryPath, bytes, error)) {
+        std::remove(temporaryPath.c_str());
+        reply(connection, 1, error);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        // the same level may have been finished by another request meanwhile
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+            std::remove(temporaryPath.c_str());
+        if (!touch(key))
+            insert(key, bytes);
+    }
+    reply(connection, 0, path);
+}
+
+bool SubdivisionServer::compute(const SubdivisionRequest& request, const std::vector<float>& positions, const std::vector<int>& triangles,
+    const std::string& path, size_t& bytes, std::string& error)
+{
+    for (int idx : triangles) {
+        if (idx < 0 || static_cast<uint32_t>(idx) >= request.vertexCount) {
+            error = "triangle index out of range";
+            return false;
+        }
+    }
+
+    LoopSubdivision loop = LoopSubdivision();
+    ButterflySubdivision butterfly = ButterflySubdivision();
+    Sqrt3Subdivision sqrt3 = Sqrt3Subdivision();
+    TriangleSubdivison& scheme = request.scheme == SubdivisionRequest::SQRT3 ? static_cast<TriangleSubdivison&>(sqrt3)
+        : request.scheme == SubdivisionRequest::LOOP ? static_cast<TriangleSubdivison&>(loop) : butterfly;
+    bool moveVertices = request.scheme != SubdivisionRequest::BUTTERFLY;
+    scheme.setMemoryBudget(budgetBytes);
+
+    TriangleMesh mesh(positions, triangles);
+    for (uint32_t level = 0; level < request.levels; ++level) {
+        if (!scheme.subdivide(mesh, moveVertices)) {
+            error = "level " + std::to_string(level + 1) + " does not fit in the memory budget";
+            return false;
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    uint32_t header[4] = { resultMagic, resultVersion, static_cast<uint32_t>(mesh.vertexCount()), static_cast<uint32_t>(mesh.faceCount()) };
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(mesh.positions.data()), mesh.positions.size() * sizeof(float));
+    // the face half-edges hold the corners of the triangles in order
+    file.write(reinterpret_cast<const char*>(mesh.origins.data()), static_cast<size_t>(mesh.faceCount()) * 3 * sizeof(int));
+    file.close();
+    if (!file) {
+        error = "could not write " + path;
+        return false;
+    }
+
+    bytes = sizeof(header) + mesh.positions.size() * sizeof(float) + static_cast<size_t>(mesh.faceCount()) * 3 * sizeof(int);
+    return true;
+}
+
+bool SubdivisionServer::reply(LocalSocket& connection, uint32_t status, const std::string& text)
+{
+    Reply header = { status, static_cast<uint32_t>(text.size()) };
+    return connection.writeAll(&header, sizeof(header)) && connection.writeAll(text.data(), text.size());
+}
+
+bool SubdivisionServer::touch(uint64_t key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return false;
+    recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, it->second);
+    return true;
+}
+
+void SubdivisionServer::insert(uint64_t key, size_t bytes)
+{
+    recentlyUsed.push_front({ key, bytes });
+    entries[key] = recentlyUsed.begin();
+    usedBytes += bytes;
+    evict(key);
+    saveIndex();
+}
+
+void SubdivisionServer::evict(uint64_t keep)
+{
+    // clients that still map an evicted file keep reading it, the space is freed when they let go
+    while (usedBytes > budgetBytes && !recentlyUsed.empty() && recentlyUsed.back().key != keep) {
+        const CacheEntry& oldest = recentlyUsed.back();
+        if (std::remove(resultPath(oldest.key).c_str()) != 0)
+            std::cout << "could not delete " << resultPath(oldest.key) << std::endl;
+        usedBytes -= oldest.bytes;
+        entries.erase(oldest.key);
+        recentlyUsed.pop_back();
+    }
+}
+
+void SubdivisionServer::loadIndex()
+{
+    std::ifstream index(cacheDirectory + "/index.txt");
+    std::string line;
+    while (std::getline(index, line)) {
+        std::istringstream ss(line);
+        uint64_t key = 0;
+        size_t bytes = 0;
+        if (!(ss >> std::hex >> key >> std::dec >> bytes) || entries.count(key) || !std::ifstream(resultPath(key)).is_open())
+            continue;
+        // the index lists the most recent first
+        recentlyUsed.push_back({ key, bytes });
+        entries[key] = std::prev(recentlyUsed.end());
+        usedBytes += bytes;
+    }
+    evict(0);
+}
+
+void SubdivisionServer::saveIndex() const
+{
+    std::ofstream index(cacheDirectory + "/index.txt");
+    for (const CacheEntry& entry : recentlyUsed) {
+        index << std::hex << entry.key << " " << std::dec << entry.bytes << "\n";
+    }
+}
+
+int SubdivisionResult::vertexCount() const
+{
+    return static_cast<int>(reinterpret_cast<const uint32_t*>(file.data())[2]);
+}
+
+int SubdivisionResult::triangleCount() const
+{
+    return static_cast<int>(reinterpret_cast<const uint32_t*>(file.data())[3]);
+}
+
+const float* SubdivisionResult::positions() const
+{
+    return reinterpret_cast<const float*>(file.data() + resultHeaderBytes);
+}
+
+const int* SubdivisionResult::triangles() const
+{
+    return reinterpret_cast<const int*>(file.data() + resultHeaderBytes + static_cast<size_t>(vertexCount()) * 3 * sizeof(float));
+}
+
+SubdivisionClient::SubdivisionClient(const std::string& socketPath) : socketPath(socketPath) {}
+
+const std::string& SubdivisionClient::getError() const
+{
+    return error;
+}
+
+bool SubdivisionClient::send(const SubdivisionRequest& request, const std::vector<float>* positions, const std::vector<int>* triangles, std::string& text)
+{
+    LocalSocket connection;
+    if (!connection.connect(socketPath)) {
+        error = "no subdivision server at " + socketPath;
+        return false;
+    }
+
+    Reply reply;
+    bool sent = connection.writeAll(&request, sizeof(request))
+        && (!positions || connection.writeAll(positions->data(), positions->size() * sizeof(float)))
+        && (!triangles || connection.writeAll(triangles->data(), triangles->size() * sizeof(int)));
+    if (!sent || !connection.readAll(&reply, sizeof(reply))) {
+        error = "lost the connection to the subdivision server";
+        return false;
+    }
+
+    text.resize(reply.length);
+    if (!connection.readAll(&text[0], text.size())) {
+        error = "lost the connection to the subdivision server";
+        return false;
+    }
+    if (reply.status != 0) {
+        error = text;
+        return false;
+    }
+    return true;
+}
+
+bool SubdivisionClient::subdivide(const std::string& scheme, int levels, const std::vector<float>& positions, const std::vector<int>& triangles,
+    SubdivisionResult& result)
+{
+    SubdivisionRequest request;
+    if (scheme != "loop" && scheme != "butterfly" && scheme != "sqrt3") {
+        error = "unknown subdivision scheme: " + scheme;
+        return false;
+    }
+    request.scheme = scheme == "loop" ? SubdivisionRequest::LOOP : scheme == "butterfly" ? SubdivisionRequest::BUTTERFLY : SubdivisionRequest::SQRT3;
+    request.levels = static_cast<uint32_t>(std::max(0, levels));
+    request.vertexCount = static_cast<uint32_t>(positions.size() / 3);
+    request.triangleCount = static_cast<uint32_t>(triangles.size() / 3);
+
+    // the file can be evicted between the reply and the mapping, asking again recomputes it
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        std::string path;
+        if (!send(request, &positions, &triangles, path))
+            return false;
+        if (!result.file.open(path))
+            continue;
+
+        const uint32_t* header = reinterpret_cast<const uint32_t*>(result.file.data());
+        bool valid = result.file.size() >= resultHeaderBytes && header[0] == resultMagic && header[1] == resultVersion
+            && result.file.size() == resultHeaderBytes + static_cast<size_t>(header[2]) * 3 * sizeof(float) + static_cast<size_t>(header[3]) * 3 * sizeof(int);
+        if (!valid) {
+            result.file.close();
+            error = "unexpected cache file " + path;
+            return false;
+        }
+        return true;
+    }
+
+    error = "the cached level was evicted before it could be read";
+    return false;
+}
+
+bool SubdivisionClient::shutdown()
+{
+    SubdivisionRequest request;
+    request.kind = SubdivisionRequest::SHUTDOWN;
+    std::string text;
+    return send(request, nullptr, nullptr, text);
+}
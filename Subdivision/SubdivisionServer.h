@@ -0,0 +1,109 @@
+#pragma once
+#include "LocalSocket.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Wire format of a request, followed by vertexCount xyz floats and triangleCount index triples.
+// Integers and floats are sent in the byte order of the machine, both ends run on the same host.
+struct SubdivisionRequest {
+    static const uint32_t magicValue = 0x44425553;  // "SUBD"
+    enum Kind : uint32_t { SUBDIVIDE = 0, SHUTDOWN = 1 };
+    enum Scheme : uint32_t { LOOP = 0, BUTTERFLY = 1, SQRT3 = 2 };
+
+    uint32_t magic = magicValue;
+    uint32_t kind = SUBDIVIDE;
+    uint32_t scheme = LOOP;
+    uint32_t levels = 0;
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+};
+
+// Long-running daemon that subdivides meshes for other local tools over a LocalSocket.
+// Results are cached as files named by a hash of the scheme, the level, the positions and the
+// triangles. Each file holds a 16 byte header (magic, version, vertex and triangle count) and
+// then the positions and triangles of the level, so clients map it and read the level in place:
+// a cache hit costs a lookup and no copy. The least recently used files are deleted once the
+// cache holds more than its byte budget; the index is kept in the cache directory, so the cache
+// survives a restart. The budget also caps the memory of a single level being computed.
+// Requests are served on a pool; the cache directory should be an absolute path, since clients
+// open the files by the returned name.
+class SubdivisionServer
+{
+public:
+    SubdivisionServer(const std::string& cacheDirectory, size_t budgetBytes = size_t(1) << 30, int threadCount = 0);
+
+    // serves until a client sends a shutdown request, false if the socket cannot be opened
+    bool run(const std::string& socketPath);
+
+    static uint64_t contentHash(uint32_t scheme, uint32_t levels, const std::vector<float>& positions, const std::vector<int>& triangles);
+
+private:
+    struct CacheEntry {
+        uint64_t key;
+        size_t bytes;
+    };
+
+    ThreadPool pool;
+    std::string cacheDirectory;
+    size_t budgetBytes;
+
+    std::mutex cacheMutex;
+    std::list<CacheEntry> recentlyUsed;     // most recent first
+    std::unordered_map<uint64_t, std::list<CacheEntry>::iterator> entries;
+    size_t usedBytes = 0;
+    unsigned temporaryCounter = 0;
+
+    void serve(LocalSocket& connection, const SubdivisionRequest& request);
+    bool compute(const SubdivisionRequest& request, const std::vector<float>& positions, const std::vector<int>& triangles,
+        const std::string& path, size_t& bytes, std::string& error);
+    static bool reply(LocalSocket& connection, uint32_t status, const std::string& text);
+
+    // the caller holds cacheMutex for these
+    bool touch(uint64_t key);
+    void insert(uint64_t key, size_t bytes);
+    void evict(uint64_t keep);
+    void loadIndex();
+    void saveIndex() const;
+
+    std::string resultPath(uint64_t key) const;
+};
+
+// A level returned by the daemon, read in place from the mapped cache file.
+class SubdivisionResult
+{
+public:
+    int vertexCount() const;
+    int triangleCount() const;
+    // xyz per vertex and three 0-based indices per triangle
+    const float* positions() const;
+    const int* triangles() const;
+
+private:
+    friend class SubdivisionClient;
+    MappedFile file;
+};
+
+class SubdivisionClient
+{
+public:
+    explicit SubdivisionClient(const std::string& socketPath);
+
+    // scheme is "loop", "butterfly" or "sqrt3"; false with getError() set if the daemon refused or is not running
+    bool subdivide(const std::string& scheme, int levels, const std::vector<float>& positions, const std::vector<int>& triangles,
+        SubdivisionResult& result);
+    bool shutdown();
+
+    const std::string& getError() const;
+
+private:
+    std::string socketPath;
+    std::string error;
+
+    bool send(const SubdivisionRequest& request, const std::vector<float>* positions, const std::vector<int>* triangles, std::string& text);
+};
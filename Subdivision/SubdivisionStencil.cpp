@@ -0,0 +1,284 @@
+#include "SubdivisionStencil.h"
+
+#include <algorithm>
+#include <iostream>
+
+void Stencil::place(Vertex* v) const
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        x += vertices[i]->x * weights[i];
+        y += vertices[i]->y * weights[i];
+        z += vertices[i]->z * weights[i];
+    }
+    v->x = x;
+    v->y = y;
+    v->z = z;
+}
+
+void IndexStencil::place(const float* positions, float* out) const
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const float* p = positions + static_cast<size_t>(vertices[i]) * 3;
+        x += p[0] * weights[i];
+        y += p[1] * weights[i];
+        z += p[2] * weights[i];
+    }
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+}
+
+void IndexStencil::sortByPosition(const float* positions)
+{
+    auto before = [positions](int a, float weightA, int b, float weightB) {
+        const float* p = positions + static_cast<size_t>(a) * 3;
+        const float* q = positions + static_cast<size_t>(b) * 3;
+        for (int k = 0; k < 3; ++k) {
+            if (p[k] != q[k]) return p[k] < q[k];
+        }
+        return weightA < weightB;
+    };
+
+    // stencils have a dozen entries or so, insertion sort keeps both arrays in step
+    for (size_t i = 1; i < vertices.size(); ++i) {
+        int v = vertices[i];
+        float weight = weights[i];
+        size_t j = i;
+        for (; j > 0 && before(v, weight, vertices[j - 1], weights[j - 1]); --j) {
+            vertices[j] = vertices[j - 1];
+            weights[j] = weights[j - 1];
+        }
+        vertices[j] = v;
+        weights[j] = weight;
+    }
+}
+
+void StencilTable::clear()
+{
+    rowOffsets.assign(1, 0);
+    rowVertices.clear();
+    sources.clear();
+    weights.clear();
+    rowOfVertex.clear();
+    dependentOffsets.clear();
+    dependents.clear();
+}
+
+void StencilTable::addRow(int fineVertex, const IndexStencil& stencil)
+{
+    rowVertices.push_back(fineVertex);
+    sources.insert(sources.end(), stencil.vertices.begin(), stencil.vertices.end());
+    weights.insert(weights.end(), stencil.weights.begin(), stencil.weights.end());
+    rowOffsets.push_back(static_cast<int>(sources.size()));
+}
+
+void StencilTable::finish(int coarseVertexCount, int fineVertexCount)
+{
+    rowOfVertex.assign(fineVertexCount, -1);
+    for (size_t row = 0; row < rowVertices.size(); ++row) {
+        rowOfVertex[rowVertices[row]] = static_cast<int>(row);
+    }
+
+    // counting sort of the entries by source vertex, a vertex read twice by a row is listed once
+    dependentOffsets.assign(coarseVertexCount + 1, 0);
+    auto forEachDependent = [this](auto visit) {
+        for (size_t row = 0; row < rowVertices.size(); ++row) {
+            for (int e = rowOffsets[row]; e < rowOffsets[row + 1]; ++e) {
+                bool repeated = std::find(sources.begin() + rowOffsets[row], sources.begin() + e, sources[e]) != sources.begin() + e;
+                if (!repeated && sources[e] != rowVertices[row])
+                    visit(sources[e], rowVertices[row]);
+            }
+        }
+    };
+    forEachDependent([this](int source, int) { dependentOffsets[source + 1]++; });
+    for (int v = 0; v < coarseVertexCount; ++v) dependentOffsets[v + 1] += dependentOffsets[v];
+    dependents.resize(dependentOffsets.back());
+    std::vector<int> fill(dependentOffsets.begin(), dependentOffsets.end() - 1);
+    forEachDependent([this, &fill](int source, int fineVertex) { dependents[fill[source]++] = fineVertex; });
+}
+
+void StencilTable::applyRow(int row, const float* coarsePositions, float* out) const
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    for (int e = rowOffsets[row]; e < rowOffsets[row + 1]; ++e) {
+        const float* p = coarsePositions + static_cast<size_t>(sources[e]) * 3;
+        x += p[0] * weights[e];
+        y += p[1] * weights[e];
+        z += p[2] * weights[e];
+    }
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+}
+
+size_t StencilTable::memoryUsage() const
+{
+    return sizeof(StencilTable) + weights.capacity() * sizeof(float)
+        + (rowOffsets.capacity() + rowVertices.capacity() + sources.capacity() + rowOfVertex.capacity()
+            + dependentOffsets.capacity() + dependents.capacity()) * sizeof(int);
+}
+
+ChannelRefiner::ChannelRefiner(const Mesh& coarse)
+    : coarseVertexCount(coarse.vertices.size()), coarseFaceCount(coarse.faces.size())
+{
+    vertexIndex.reserve(coarse.vertices.size());
+    for (size_t i = 0; i < coarse.vertices.size(); ++i) {
+        vertexIndex[coarse.vertices[i]] = static_cast<int>(i);
+    }
+
+    // the schemes split triangles, so every face has three corners
+    cornerVertices.reserve(coarse.faces.size() * 3);
+    for (const Face* face : coarse.faces) {
+        for (Vertex* v : face->vertices()) {
+            cornerVertices.push_back(vertexIndex[v]);
+        }
+    }
+}
+
+void ChannelRefiner::record(const Vertex* fineVertex, const Stencil& stencil)
+{
+    rowOf[fineVertex] = static_cast<int>(rowOffsets.size()) - 1;
+    for (size_t i = 0; i < stencil.vertices.size(); ++i) {
+        sources.push_back(vertexIndex[stencil.vertices[i]]);
+        weights.push_back(stencil.weights[i]);
+    }
+    rowOffsets.push_back(static_cast<int>(sources.size()));
+}
+
+void ChannelRefiner::mapEdges(const Mesh& coarse, std::unordered_map<HalfEdge*, Vertex*>& edgeVertexMap)
+{
+    cornerEdgeRows.clear();
+    cornerEdgeRows.reserve(coarse.faces.size() * 3);
+    for (const Face* face : coarse.faces) {
+        for (HalfEdge* he : face->halfEdges()) {
+            auto row = rowOf.find(edgeVertexMap[he]);
+            cornerEdgeRows.push_back(row != rowOf.end() ? row->second : -1);
+        }
+    }
+}
+
+void ChannelRefiner::refine(Mesh& fine) const
+{
+    for (auto channel = fine.channels.begin(); channel != fine.channels.end();) {
+        size_t expected = (channel->faceVarying ? coarseFaceCount * 3 : coarseVertexCount) * channel->width;
+        if (channel->width < 1 || channel->values.size() != expected || cornerVertices.size() != coarseFaceCount * 3) {
+            std::cout << "Error: dropping channel " << channel->name << ", it does not match the mesh" << std::endl;
+            channel = fine.channels.erase(channel);
+            continue;
+        }
+
+        if (channel->faceVarying)
+            refineFaceVaryingChannel(fine, *channel);
+        else
+            refineVertexChannel(fine, *channel);
+        ++channel;
+    }
+}
+
+void ChannelRefiner::applyRow(int row, const float* values, const int* sourceSlots, int width, float* out) const
+{
+    for (int c = 0; c < width; ++c) out[c] = 0.0f;
+    for (int e = rowOffsets[row]; e < rowOffsets[row + 1]; ++e) {
+        const float* source = values + static_cast<size_t>(sourceSlots ? sourceSlots[sources[e]] : sources[e]) * width;
+        for (int c = 0; c < width; ++c) {
+            out[c] += source[c] * weights[e];
+        }
+    }
+}
+
+void ChannelRefiner::refineVertexChannel(const Mesh& fine, AttributeChannel& channel) const
+{
+    int width = channel.width;
+    std::vector<float> refined(fine.vertices.size() * width, 0.0f);
+
+    for (size_t i = 0; i < fine.vertices.size(); ++i) {
+        auto row = rowOf.find(fine.vertices[i]);
+        if (row != rowOf.end()) {
+            applyRow(row->second, channel.values.data(), nullptr, width, &refined[i * width]);
+        }
+        // vertices that were not moved keep their index and value
+        else if (i < coarseVertexCount) {
+            std::copy(channel.values.begin() + i * width, channel.values.begin() + (i + 1) * width, refined.begin() + i * width);
+        }
+    }
+
+    channel.values.swap(refined);
+}
+
+void ChannelRefiner::refineFaceVaryingChannel(const Mesh& fine, AttributeChannel& channel) const
+{
+    int width = channel.width;
+    const std::vector<float>& values = channel.values;
+
+    // a vertex is smooth if all its corners agree, its corner values then act as one vertex value
+    std::vector<int> representative(coarseVertexCount, -1);
+    std::vector<bool> smooth(coarseVertexCount, true);
+    for (size_t c = 0; c < cornerVertices.size(); ++c) {
+        int v = cornerVertices[c];
+        if (representative[v] < 0) {
+            representative[v] = static_cast<int>(c);
+        }
+        else if (!std::equal(values.begin() + c * width, values.begin() + (c + 1) * width, values.begin() + representative[v] * width)) {
+            smooth[v] = false;
+        }
+    }
+
+    auto usable = [&](int row) {
+        if (row < 0)
+            return false;
+        for (int e = rowOffsets[row]; e < rowOffsets[row + 1]; ++e) {
+            if (!smooth[sources[e]] || representative[sources[e]] < 0)
+                return false;
+        }
+        return true;
+    };
+
+    std::vector<int> vertexRows(coarseVertexCount, -1);
+    for (size_t v = 0; v < coarseVertexCount && v < fine.vertices.size(); ++v) {
+        auto row = rowOf.find(fine.vertices[v]);
+        if (row != rowOf.end()) vertexRows[v] = row->second;
+    }
+
+    if (fine.faces.size() != coarseFaceCount * 4) {
+        std::cout << "Error: dropping the values of channel " << channel.name << ", the faces were not split in four" << std::endl;
+        channel.values.assign(fine.faces.size() * 3 * width, 0.0f);
+        return;
+    }
+
+    std::vector<float> refined(coarseFaceCount * 12 * width);
+    std::vector<float> corner(3 * width), edge(3 * width);
+    for (size_t f = 0; f < coarseFaceCount; ++f) {
+        for (int k = 0; k < 3; ++k) {
+            size_t c = f * 3 + k, next = f * 3 + (k + 1) % 3;
+            int vertexRow = vertexRows[cornerVertices[c]];
+            int edgeRow = cornerEdgeRows.empty() ? -1 : cornerEdgeRows[c];
+
+            if (usable(vertexRow))
+                applyRow(vertexRow, values.data(), representative.data(), width, &corner[k * width]);
+            else
+                std::copy(values.begin() + c * width, values.begin() + (c + 1) * width, corner.begin() + k * width);
+
+            if (usable(edgeRow)) {
+                applyRow(edgeRow, values.data(), representative.data(), width, &edge[k * width]);
+            }
+            else {
+                for (int i = 0; i < width; ++i) edge[k * width + i] = (values[c * width + i] + values[next * width + i]) * 0.5f;
+            }
+        }
+
+        // the four faces of rebuildFace: (c0 e0 e2) (e0 e1 e2) (e0 c1 e1) (e2 e1 c2)
+        const float* fineCorners[12] = {
+            &corner[0], &edge[0], &edge[2 * width],
+            &edge[0], &edge[width], &edge[2 * width],
+            &edge[0], &corner[width], &edge[width],
+            &edge[2 * width], &edge[width], &corner[2 * width]
+        };
+        for (int i = 0; i < 12; ++i) {
+            std::copy(fineCorners[i], fineCorners[i] + width, refined.begin() + (f * 12 + i) * width);
+        }
+    }
+
+    channel.values.swap(refined);
+}
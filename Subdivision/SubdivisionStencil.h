@@ -0,0 +1,112 @@
+#pragma once
+#include "HalfEdge.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Weights of the coarse vertices that make up one vertex of the next level.
+// The scheme rules only fill stencils, so positions and attribute channels use the same weights.
+// Handle is Vertex* on a Mesh and the vertex index on a TriangleMesh.
+template <class Handle>
+class BasicStencil
+{
+public:
+    void clear()
+    {
+        vertices.clear();
+        weights.clear();
+    }
+
+    void add(Handle v, float weight)
+    {
+        vertices.push_back(v);
+        weights.push_back(weight);
+    }
+
+    std::vector<Handle> vertices;
+    std::vector<float> weights;
+};
+
+class Stencil : public BasicStencil<Vertex*>
+{
+public:
+    // x, y and z of v become the weighted sum of the coarse positions
+    void place(Vertex* v) const;
+};
+
+class IndexStencil : public BasicStencil<int>
+{
+public:
+    // out gets the weighted sum of the xyz triples in positions
+    void place(const float* positions, float* out) const;
+    // orders the entries by position and weight, so the sum of place no longer depends on the
+    // vertex numbering and overlapping patches compute the same bits for a shared vertex
+    void sortByPosition(const float* positions);
+};
+
+// The stencils of one TriangleMesh level as compressed rows over the vertices of the coarser
+// level, and the transposed table that lists the fine vertices reading each coarse vertex.
+// A fine vertex without a row keeps the position of the coarse vertex with the same index.
+class StencilTable
+{
+public:
+    void clear();
+    // rows can be added in any order, but once per fine vertex
+    void addRow(int fineVertex, const IndexStencil& stencil);
+    // call once after the last row, before dependents and rowOf
+    void finish(int coarseVertexCount, int fineVertexCount);
+
+    // -1 if the vertex has no row
+    int rowOf(int fineVertex) const { return rowOfVertex[fineVertex]; }
+    // the same sum as IndexStencil::place, so the bits match a full rebuild
+    void applyRow(int row, const float* coarsePositions, float* out) const;
+
+    // fine vertices whose rows read coarse vertex v, the vertex with the same index not included
+    const int* dependentsBegin(int v) const { return dependents.data() + dependentOffsets[v]; }
+    const int* dependentsEnd(int v) const { return dependents.data() + dependentOffsets[v + 1]; }
+
+    size_t memoryUsage() const;
+
+private:
+    std::vector<int> rowOffsets = { 0 };
+    std::vector<int> rowVertices;
+    std::vector<int> sources;
+    std::vector<float> weights;
+    std::vector<int> rowOfVertex;
+    std::vector<int> dependentOffsets;
+    std::vector<int> dependents;
+};
+
+// Records the stencils of one level and applies them to the attribute channels of the mesh.
+// Every stencil becomes a row of a compressed sparse table over coarse vertex indices, each
+// channel is then refined in one pass over the table. Face-varying values are smoothed like
+// positions where all vertices of a stencil have a single value, next to seams and boundaries
+// they are interpolated linearly inside each face, so the two sides of a seam stay apart.
+class ChannelRefiner
+{
+public:
+    // indexes the vertices and face corners of the coarse level, before it is modified
+    explicit ChannelRefiner(const Mesh& coarse);
+
+    void record(const Vertex* fineVertex, const Stencil& stencil);
+    // remembers the edge vertex of every face corner, once all edge vertices are created
+    void mapEdges(const Mesh& coarse, std::unordered_map<HalfEdge*, Vertex*>& edgeVertexMap);
+    // replaces the channel values after the faces are split in four
+    void refine(Mesh& fine) const;
+
+private:
+    std::unordered_map<const Vertex*, int> vertexIndex;
+    std::unordered_map<const Vertex*, int> rowOf;
+    size_t coarseVertexCount = 0;
+    size_t coarseFaceCount = 0;
+    std::vector<int> cornerVertices;    // three per coarse face
+    std::vector<int> cornerEdgeRows;    // row of the vertex on the edge leaving each corner
+
+    std::vector<int> rowOffsets = { 0 };
+    std::vector<int> sources;
+    std::vector<float> weights;
+
+    void applyRow(int row, const float* values, const int* sourceSlots, int width, float* out) const;
+    void refineVertexChannel(const Mesh& fine, AttributeChannel& channel) const;
+    void refineFaceVaryingChannel(const Mesh& fine, AttributeChannel& channel) const;
+};
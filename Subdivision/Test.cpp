@@ -15,13 +15,31 @@
 #include <string>
 #include <cstdlib> 
 #include <ctime> 
+#include <chrono>
 #include <cmath>
 #include <functional>
 
 //#include "HalfEdge.h"
+#include "BatchProcessor.h"
 #include "ButterflySubdivision.h"
+#include "FaceBVH.h"
+#include "FrameTimer.h"
+#include "IncrementalSubdivision.h"
+#include "LevelCache.h"
 #include "LoopSubdivision.h"
+#include "MemoryEstimate.h"
+#include "MeshDecimation.h"
+#include "MeshReorder.h"
+#include "MultiresCodec.h"
+#include "ObjLoader.h"
+#include "OutOfCoreSubdivision.h"
+#include "SelfTest.h"
 #include "Shadings.h"
+#include "SoftwareRasterizer.h"
+#include "Sqrt3Subdivision.h"
+#include "StreamingSubdivision.h"
+#include "SubdivisionJob.h"
+#include "SubdivisionServer.h"
 
 // Global variables for rotation angles
 
@@ -45,12 +63,47 @@ float viewRadius = 0.0f;
 
 Mesh* meshPtr = nullptr;
 
-std::unordered_map<Vertex*, float[3]> vertexNormals;
-std::unordered_map<Face*, float[3]> faceNormals;
-
 ShadingTypes activeShading = FLAT;
 FillStatus activeFillStatus = FillStatus::FILL;
 
+// renumber vertices and faces for cache locality after loading and after every level
+bool reorderMesh = true;
+
+// vertices of the loaded OBJ closer than this are merged into one
+float weldTolerance = 1e-5f;
+
+// subdivision runs in the background, meshPtr is only swapped on the GLUT thread once a job is done
+SubdivisionJob* activeJob = nullptr;
+std::vector<SubdivisionJob*> retiredJobs;
+int jobPollMilliseconds = 50;
+std::string jobScheme;
+int jobLevel = 0;
+
+// computed levels of every scheme, meshPtr always points into this cache
+LevelCache* levelCache = nullptr;
+size_t levelCacheBudget = size_t(512) << 20;
+std::string currentScheme = "loop";
+int currentLevel = 0;
+
+// levels predicted to need more memory than this are refused, use --out-of-core for those
+size_t subdivisionBudget = size_t(2) << 30;
+
+// ray picking on the mesh under the cursor, the BVH is rebuilt whenever meshPtr changes
+// and refitted when a vertex of it is dragged
+ThreadPool* workerPool = nullptr;
+FaceBVH pickingBVH;
+PickResult picked;
+Vertex* draggedVertex = nullptr;
+GLdouble dragDepth = 0.0;
+GLdouble pickModelview[16], pickProjection[16];
+GLint pickViewport[4];
+
+// every frame of renderMesh is timed, the nav bar shows the averages of the last frames and 'f' writes them out
+FrameTimer frameTimer;
+size_t frameAverageCount = 30;
+std::string frameLogFile = "frames.csv";
+size_t meshTriangles = 0;
+
 
 // CUSTOM UI COMPONENTS
 struct Button {
@@ -71,6 +124,9 @@ std::vector<Button> navButtons;
 enum MenuState { MAIN_MENU, FILL_MENU, SUBDIVISION_MENU, SHADING_MENU };
 MenuState menuState = MAIN_MENU;
 void setMenuState(MenuState newState);
+void showLevel(const std::string& scheme, int level);
+void subdivideWith(const std::string& scheme);
+void cancelSubdivision();
 
 float buttonYMin = 0.92f;
 float buttonYMax = 0.98f;
@@ -90,16 +146,19 @@ std::vector<Button> fillMenuButtons = {
 
 std::vector<Button> subdivisonMenuButtons = {
     {"Back", -0.95f, -0.65f, buttonYMin, buttonYMax, []() {setMenuState(MAIN_MENU); } },
-    {"Loop", -0.63f, -0.3f, buttonYMin, buttonYMax, []() {
+    {"Loop", -0.63f, -0.35f, buttonYMin, buttonYMax, []() {
         std::cout << "\nLoop subdivison" << std::endl;
-        LoopSubdivision subdivison = LoopSubdivision();
-        subdivison.subdivide(meshPtr, true);
+        subdivideWith("loop");
     }},
-    {"Butterfly", -0.28f, 0.08f, buttonYMin, buttonYMax, []() { 
+    {"Butterfly", -0.33f, 0.03f, buttonYMin, buttonYMax, []() { 
         std::cout << "\nButterfly subdivison" << std::endl;
-        ButterflySubdivision subdivison = ButterflySubdivision();
-        subdivison.subdivide(meshPtr, false);
-    }}
+        subdivideWith("butterfly");
+    }},
+    {"Sqrt3", 0.05f, 0.3f, buttonYMin, buttonYMax, []() {
+        std::cout << "\nSqrt3 subdivison" << std::endl;
+        subdivideWith("sqrt3");
+    }},
+    {"Cancel", 0.32f, 0.62f, buttonYMin, buttonYMax, []() { cancelSubdivision(); }}
 };
 
 std::vector<Button> shadingMenuButtons = {
@@ -147,6 +206,127 @@ void setMenuState(MenuState newState) {
 
     updateNavBar();
 }
+
+ThreadPool* getWorkerPool() {
+    if (workerPool == nullptr)
+        workerPool = new ThreadPool();
+    return workerPool;
+}
+
+// moved is true if only vertex positions of the mesh changed since the last call
+void updatePicking(bool moved = false) {
+    picked = PickResult();
+    // the same faces only need new bounds, the tree holds face pointers
+    if (moved && meshPtr->faces.size() == pickingBVH.faceCount()) {
+        pickingBVH.refit();
+        return;
+    }
+    draggedVertex = nullptr;
+    pickingBVH.build(*meshPtr, getWorkerPool());
+
+    // polygons are drawn as degree - 2 triangles
+    meshTriangles = 0;
+    for (const Face* face : meshPtr->faces) meshTriangles += face->degree() - 2;
+}
+
+void pollSubdivision(int) {
+    // cancelled jobs may still be unwinding, they are deleted once their thread is done
+    for (auto it = retiredJobs.begin(); it != retiredJobs.end();) {
+        if ((*it)->isFinished()) {
+            delete *it;
+            it = retiredJobs.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (activeJob != nullptr && activeJob->isFinished()) {
+        Mesh* result = activeJob->takeResult();
+        if (result != nullptr) {
+            levelCache->insert(jobScheme, jobLevel, result);
+            meshPtr = result;
+            updatePicking();
+            currentScheme = jobScheme;
+            currentLevel = jobLevel;
+            std::cout << "Showing level " << currentLevel << " of " << currentScheme
+                << ", cache uses " << levelCache->memoryUsage() / 1024 << " KB" << std::endl;
+        }
+        delete activeJob;
+        activeJob = nullptr;
+    }
+
+    if (activeJob != nullptr || !retiredJobs.empty()) {
+        glutTimerFunc(jobPollMilliseconds, pollSubdivision, 0);
+    }
+    glutPostRedisplay();
+}
+
+void showLevel(const std::string& scheme, int level) {
+    // a new request replaces the running one
+    bool polling = activeJob != nullptr || !retiredJobs.empty();
+    cancelSubdivision();
+
+    Mesh* cached = levelCache->find(scheme, level);
+    if (cached != nullptr) {
+        meshPtr = cached;
+        updatePicking();
+        currentScheme = scheme;
+        currentLevel = level;
+        std::cout << "Showing cached level " << level << " of " << scheme << std::endl;
+        glutPostRedisplay();
+        return;
+    }
+
+    Mesh* coarser = nullptr;
+    int coarserLevel = levelCache->nearestCoarser(scheme, level, coarser);
+    bool isSqrt3 = scheme == "sqrt3";
+    // only Butterfly interpolates, the other schemes move the old vertices
+    bool moveVertices = scheme != "butterfly";
+
+    LevelEstimate estimate = (isSqrt3
+        ? MemoryEstimate::predictSqrt3(*coarser, level - coarserLevel, coarserLevel)
+        : MemoryEstimate::predict(*coarser, level - coarserLevel, moveVertices)).back();
+    std::cout << "Level " << level << " of " << scheme << " will have " << estimate.faces << " faces and "
+        << estimate.vertices << " vertices, it needs about " << MemoryEstimate::formatBytes(estimate.peakBytes) << std::endl;
+    if (estimate.peakBytes > subdivisionBudget) {
+        std::cout << "Refusing: the budget is " << MemoryEstimate::formatBytes(subdivisionBudget);
+        if (!isSqrt3)
+            std::cout << ", run --out-of-core " << scheme << " " << level << " for this level";
+        std::cout << std::endl;
+        return;
+    }
+    std::cout << "Subdividing level " << level << " of " << scheme << " from level " << coarserLevel << std::endl;
+
+    std::unique_ptr<TriangleSubdivison> subdivision(isSqrt3 ? static_cast<TriangleSubdivison*>(new Sqrt3Subdivision(coarserLevel))
+        : scheme == "loop" ? static_cast<TriangleSubdivison*>(new LoopSubdivision())
+        : new ButterflySubdivision());
+    subdivision->setMemoryBudget(subdivisionBudget);
+    subdivision->setThreadPool(getWorkerPool());
+
+    jobScheme = scheme;
+    jobLevel = level;
+    activeJob = new SubdivisionJob(coarser, std::move(subdivision), moveVertices, level - coarserLevel, reorderMesh);
+    if (!polling)
+        glutTimerFunc(jobPollMilliseconds, pollSubdivision, 0);
+}
+
+void subdivideWith(const std::string& scheme) {
+    // one level finer with the same scheme, switching scheme keeps the level
+    int level = scheme == currentScheme ? currentLevel + 1 : std::max(currentLevel, 1);
+    showLevel(scheme, level);
+}
+
+void cancelSubdivision() {
+    if (activeJob == nullptr)
+        return;
+
+    std::cout << "Cancelling subdivison" << std::endl;
+    activeJob->cancel();
+    retiredJobs.push_back(activeJob);
+    activeJob = nullptr;
+    glutPostRedisplay();
+}
 // END OF CUSTOM UI COMPONENTS
 
 // Function to calculate the midpoint of the object
@@ -223,6 +403,15 @@ void keyInput(unsigned char key, int x, int y)
     case 'Y': angleY -= 5.0f; break; // Rotate around Y-axis (reverse)
     case 'Z': angleZ -= 5.0f; break; // Rotate around Z-axis (reverse)
     case 27: exit(0); break;
+    case 'c': cancelSubdivision(); break;
+    case 'f': frameTimer.writeCSV(frameLogFile); break;
+    case '[': showLevel(currentScheme, std::max(currentLevel - 1, 0)); break;
+    case ']': showLevel(currentScheme, currentLevel + 1); break;
+    case 'r': {
+        reorderMesh = !reorderMesh;
+        std::cout << "Reordering after each level: " << (reorderMesh ? "on" : "off") << std::endl;
+        break;
+    }
     case '+': {
         paddingFactor += 0.1;
         setPadding(paddingFactor);
@@ -239,55 +428,6 @@ void keyInput(unsigned char key, int x, int y)
     glutPostRedisplay();  // Request a redraw after movement
 }
 
-int extractFirstNumber(const std::string& coordinate) {
-    size_t firstSlash = coordinate.find('/');
-    if (firstSlash != std::string::npos) {
-        // If it's in the "vertex/texture/normal" format, take the first index
-        std::string firstPart = coordinate.substr(0, firstSlash);
-        return std::stoi(firstPart);  // Convert to integer
-    }
-    else {
-        return std::stoi(coordinate);
-    }
-}
-
-void loadOBJ(const std::string& filename, std::vector<std::vector<float>>& verticesPos, std::vector<std::vector<int>>& facesIndices) {
-    std::ifstream objFile(filename);
-    if (!objFile.is_open()) {
-        std::cerr << "Could not open the file: " << filename << std::endl;
-        return;
-    }
-
-    std::string line;
-    while (std::getline(objFile, line)) {
-        std::istringstream ss(line);
-        std::string token;
-        ss >> token;
-
-        // Process vertex position
-        if (token == "v") {
-            std::vector<float> vertex(3);
-            ss >> vertex[0] >> vertex[1] >> vertex[2];
-            verticesPos.push_back(vertex);
-        }
-
-        // Process face indices
-        else if (token == "f") {
-            std::vector<int> face;
-            std::string vertexData;
-            while (ss >> vertexData) {
-                int index = extractFirstNumber(vertexData);
-                face.push_back(index);
-            }
-            facesIndices.push_back(face);
-        }
-    }
-    std::cout << "Loaded OBJ with " << verticesPos.size() << " vertices and " << facesIndices.size() << " faces.\n";
-
-    objFile.close();
-}
-
-
 void renderMesh() {
 
     //srand(static_cast<unsigned>(time(0)));
@@ -302,17 +442,8 @@ void renderMesh() {
         }*/
 
 
-        HalfEdge* startEdge = meshPtr->faces[i]->edge;
-        HalfEdge* currentEdge = startEdge;
-
-        // get vertices for face
-        // TODO: add support map to the data structure and use it everytime we need the vertices of a face
-        std::vector<Vertex*> vertices;
-        do {
-            vertices.push_back(currentEdge->origin);
-
-            currentEdge = currentEdge->next;
-        } while (currentEdge != startEdge);  // Visszatrnk a kezd lhez
+        // vertices of the face, walked directly on the half-edges
+        LoopVertices vertices = meshPtr->faces[i]->vertices();
 
         // draw line if needed
         if (activeFillStatus == WIRE || activeFillStatus == WIREFILL) {
@@ -350,6 +481,43 @@ void renderMesh() {
     }
 }
 
+void renderPicked() {
+    if (picked.face == nullptr)
+        return;
+
+    // drawn on top of the mesh
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+
+    glLineWidth(3.0f);
+    glColor3f(1.0f, 1.0f, 0.0f);
+    glBegin(GL_LINE_LOOP);
+    HalfEdge* startEdge = picked.face->edge;
+    HalfEdge* currentEdge = startEdge;
+    do {
+        glVertex3f(currentEdge->origin->x, currentEdge->origin->y, currentEdge->origin->z);
+        currentEdge = currentEdge->next;
+    } while (currentEdge != startEdge);
+    glEnd();
+
+    glColor3f(0.0f, 0.0f, 1.0f);
+    glBegin(GL_LINES);
+    glVertex3f(picked.edge->origin->x, picked.edge->origin->y, picked.edge->origin->z);
+    glVertex3f(picked.edge->next->origin->x, picked.edge->next->origin->y, picked.edge->next->origin->z);
+    glEnd();
+    glLineWidth(1.0f);
+
+    glPointSize(8.0f);
+    glColor3f(0.0f, 1.0f, 0.0f);
+    glBegin(GL_POINTS);
+    glVertex3f(picked.vertex->x, picked.vertex->y, picked.vertex->z);
+    glEnd();
+    glPointSize(1.0f);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_LIGHTING);
+}
+
 void updateHoverState(float x, float y) {
     for (auto& button : navButtons) {
         button.isHovered = (x > button.xStart && x < button.xEnd && y > button.yStart && y < button.yEnd);
@@ -364,17 +532,66 @@ void mouseMove(int x, int y) {
     glutPostRedisplay();
 }
 
+void pickAt(int x, int y) {
+    // ray through the pixel from the near to the far plane, in mesh space
+    GLdouble nearPoint[3], farPoint[3];
+    GLdouble windowY = pickViewport[3] - y;
+    gluUnProject(x, windowY, 0.0, pickModelview, pickProjection, pickViewport, &nearPoint[0], &nearPoint[1], &nearPoint[2]);
+    gluUnProject(x, windowY, 1.0, pickModelview, pickProjection, pickViewport, &farPoint[0], &farPoint[1], &farPoint[2]);
+
+    float origin[3], direction[3];
+    for (int k = 0; k < 3; ++k) {
+        origin[k] = static_cast<float>(nearPoint[k]);
+        direction[k] = static_cast<float>(farPoint[k] - nearPoint[k]);
+    }
+
+    if (pickingBVH.pick(origin, direction, picked)) {
+        std::cout << "\nPicked " << picked.face->toString() << std::endl;
+        std::cout << picked.vertex->toString() << std::endl;
+        std::cout << picked.edge->toString();
+    }
+    glutPostRedisplay();
+}
+
 void mouseClick(int button, int state, int x, int y) {
     if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
         for (auto& btn : navButtons) {
             if (btn.isHovered) {
                 btn.onClick();
-                break;
+                return;
             }
         }
+        pickAt(x, y);
+
+        // a running job may be reading the shown mesh, so it is only edited while none runs
+        if (picked.vertex != nullptr && activeJob == nullptr) {
+            GLdouble windowX, windowY;
+            draggedVertex = picked.vertex;
+            gluProject(draggedVertex->x, draggedVertex->y, draggedVertex->z, pickModelview, pickProjection, pickViewport,
+                &windowX, &windowY, &dragDepth);
+        }
+    }
+    else if (button == GLUT_LEFT_BUTTON && state == GLUT_UP) {
+        draggedVertex = nullptr;
     }
 }
 
+// moves the picked vertex in the plane parallel to the screen
+void mouseDrag(int x, int y) {
+    if (draggedVertex == nullptr || activeJob != nullptr)
+        return;
+
+    GLdouble position[3];
+    gluUnProject(x, pickViewport[3] - y, dragDepth, pickModelview, pickProjection, pickViewport, &position[0], &position[1], &position[2]);
+    draggedVertex->x = static_cast<float>(position[0]);
+    draggedVertex->y = static_cast<float>(position[1]);
+    draggedVertex->z = static_cast<float>(position[2]);
+
+    Shadings::updateNormalsAround(draggedVertex, meshPtr);
+    updatePicking(true);
+    glutPostRedisplay();
+}
+
 void drawNavBar(void) {
     glDisable(GL_DEPTH_TEST);
     glMatrixMode(GL_PROJECTION);
@@ -425,13 +642,47 @@ void drawNavBar(void) {
     }
 
     glColor3f(1.0f, 1.0f, 0.0f);
-    glRasterPos2f(0.5f, buttonYMin + 0.001f);
+    glRasterPos2f(0.5f, buttonYMin + 0.035f);
 
     std::ostringstream oss;
-    oss << "Padding: " << paddingFactor * 100 << "%";
+    if (activeJob != nullptr)
+        oss << "Subdividing: " << static_cast<int>(activeJob->getProgress() * 100) << "%";
+    else
+        oss << "Padding: " << paddingFactor * 100 << "%";
 
     for (const char& c : oss.str()) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c);
+        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+    }
+
+    // CPU / GPU milliseconds of renderMesh and the triangle rate, averaged over the last frames
+    glRasterPos2f(0.5f, buttonYMin + 0.001f);
+    std::ostringstream frameText;
+    frameText.setf(std::ios::fixed);
+    frameText.precision(1);
+    double cpuMilliseconds = frameTimer.averageCpuMilliseconds(frameAverageCount);
+    double gpuMilliseconds = frameTimer.averageGpuMilliseconds(frameAverageCount);
+    if (cpuMilliseconds >= 0.0) {
+        frameText << cpuMilliseconds << "/";
+        if (gpuMilliseconds >= 0.0)
+            frameText << gpuMilliseconds;
+        else
+            frameText << "-";
+        frameText << "ms " << frameTimer.trianglesPerSecond(frameAverageCount) / 1e6 << "Mt/s";
+    }
+    for (const char& c : frameText.str()) {
+        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+    }
+
+    if (picked.face != nullptr) {
+        glColor3f(0.0f, 0.0f, 0.0f);
+        glRasterPos2f(-0.95f, -0.95f);
+
+        std::ostringstream pickText;
+        pickText << picked.face->name << "  " << picked.vertex->name << "  " << picked.edge->name
+            << " (twin " << (picked.edge->twin ? picked.edge->twin->name : "-") << ")";
+        for (const char& c : pickText.str()) {
+            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+        }
     }
 
     glEnable(GL_LIGHTING);
@@ -456,8 +707,21 @@ void drawScene(void) {
     glRotatef(angleZ, 0.0f, 0.0f, 1.0f);
     glTranslatef(-centerX, -centerY, -centerZ);
 
+    // kept for unprojecting mouse clicks
+    glGetDoublev(GL_MODELVIEW_MATRIX, pickModelview);
+    glGetDoublev(GL_PROJECTION_MATRIX, pickProjection);
+    glGetIntegerv(GL_VIEWPORT, pickViewport);
+
     if (meshPtr != nullptr) {
+        static const char* shadingNames[] = { "flat", "gouraud", "phong", "none" };
+        static const char* fillNames[] = { "wire", "fill", "wirefill" };
+        std::ostringstream label;
+        label << currentScheme << " " << currentLevel << " " << shadingNames[activeShading] << " " << fillNames[activeFillStatus];
+
+        frameTimer.beginFrame();
         renderMesh();
+        frameTimer.endFrame(activeFillStatus == WIRE ? 0 : meshTriangles, label.str());
+        renderPicked();
     }
 
     glFlush();
@@ -480,18 +744,19 @@ void populateHalfEdgeStructure(const std::string& objFile) {
         {3, 6, 4}, {4, 6, 7}, {4, 7, 5}
     };*/
 
-    std::vector<std::vector<float>> vertexPositions;
-    std::vector<std::vector<int>> faceIndices;
-
-
-    loadOBJ(objFile, vertexPositions, faceIndices);
+    MeshArrays arrays;
+    loadOBJ(objFile, arrays, getWorkerPool());
 
-    // Create mesh
-    meshPtr = new Mesh(faceIndices, vertexPositions);
+    // Create mesh, the topology is sorted out on the worker pool
+    meshPtr = new Mesh(arrays, weldTolerance, getWorkerPool());
+    if (reorderMesh)
+        MeshReorder::reorder(meshPtr);
 
     std::cout << "Mesh created successfully:" << std::endl;
 
     Shadings::calculateNormals(meshPtr);
+    levelCache = new LevelCache(meshPtr, levelCacheBudget);
+    updatePicking();
 
     //std::cout << meshPtr->toString();
 }
@@ -504,13 +769,7 @@ void checkForErrors() {
     // Check for square faces
     int squareFaceCounter = 0;
     for (auto& face : meshPtr->faces) {
-        int edgeCounter = 1;
-        HalfEdge* start = face->edge;
-        HalfEdge* next = start->next;
-        while (next != start) {
-            edgeCounter++;
-            next = next->next;
-        }
+        int edgeCounter = face->degree();
         if (edgeCounter == 4)
             squareFaceCounter++;
         else if (edgeCounter > 4)
@@ -522,9 +781,335 @@ void checkForErrors() {
 }
 
 
+// Subdivides an OBJ file patch by patch without building the whole mesh in memory.
+int runOutOfCore(const std::string& schemeName, int levels, const std::string& inputFile, const std::string& outputFile) {
+    LoopSubdivision loop = LoopSubdivision();
+    ButterflySubdivision butterfly = ButterflySubdivision();
+
+    bool isLoop = schemeName == "loop";
+    if (!isLoop && schemeName != "butterfly") {
+        std::cerr << "Unknown subdivision scheme: " << schemeName << std::endl;
+        return 1;
+    }
+
+    OutOfCoreSubdivision subdivision(isLoop ? static_cast<TriangleSubdivison&>(loop) : butterfly, isLoop, isLoop ? 1 : 2, isLoop ? 1 : 3);
+    return subdivision.subdivide(inputFile, outputFile, levels) ? 0 : 1;
+}
+
+
+// Writes a deep level to a binary STL face by face, the level itself is never built.
+int runStream(const std::string& schemeName, int levels, const std::string& inputFile, const std::string& outputFile) {
+    LoopSubdivision loop = LoopSubdivision();
+    ButterflySubdivision butterfly = ButterflySubdivision();
+
+    bool isLoop = schemeName == "loop";
+    if (!isLoop && schemeName != "butterfly") {
+        std::cerr << "Unknown subdivision scheme: " << schemeName << std::endl;
+        return 1;
+    }
+
+    MeshArrays arrays;
+    loadOBJ(inputFile, arrays);
+    if (arrays.faceCount() == 0)
+        return 1;
+
+    TriangleMesh base(std::move(arrays));
+    int ringDepth = isLoop ? 1 : base.boundaryCount() > 0 ? 3 : 2;
+    StreamingSubdivision subdivision(isLoop ? static_cast<TriangleSubdivison&>(loop) : butterfly, isLoop, ringDepth);
+    return subdivision.subdivideToSTL(base, levels, outputFile) ? 0 : 1;
+}
+
+
+// Runs the subdivision daemon until a client asks it to stop.
+int runServer(const std::string& socketPath, const std::string& cacheDirectory, size_t budgetBytes, int threadCount) {
+    SubdivisionServer server(cacheDirectory, budgetBytes, threadCount);
+    return server.run(socketPath) ? 0 : 1;
+}
+
+
+// Asks the daemon for a level of an OBJ file, the result is read from the shared cache file.
+int runRequest(const std::string& socketPath, const std::string& schemeName, int levels, const std::string& inputFile, const std::string& outputFile) {
+    MeshArrays arrays;
+    loadOBJ(inputFile, arrays);
+    if (arrays.faceCount() == 0)
+        return 1;
+
+    // polygons are sent as triangle fans
+    TriangleMesh base(std::move(arrays));
+    std::vector<int> triangles(base.origins.begin(), base.origins.begin() + base.faceCount() * 3);
+
+    auto start = std::chrono::steady_clock::now();
+    SubdivisionClient client(socketPath);
+    SubdivisionResult result;
+    if (!client.subdivide(schemeName, levels, base.positions, triangles, result)) {
+        std::cerr << client.getError() << std::endl;
+        return 1;
+    }
+    std::cout << "received " << result.vertexCount() << " vertices and " << result.triangleCount() << " triangles in "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+    if (outputFile.empty())
+        return 0;
+    TriangleMesh level(std::vector<float>(result.positions(), result.positions() + result.vertexCount() * 3),
+        std::vector<int>(result.triangles(), result.triangles() + result.triangleCount() * 3));
+    return saveOBJ(outputFile, level) ? 0 : 1;
+}
+
+
+// Subdivides every asset listed in a manifest on a shared thread pool.
+int runBatch(const std::string& manifestFile, int threadCount) {
+    std::vector<BatchJob> jobs;
+    if (!BatchProcessor::readManifest(manifestFile, jobs))
+        return 1;
+
+    BatchProcessor processor(threadCount);
+    std::vector<BatchResult> results = processor.run(jobs);
+    BatchProcessor::printReport(results, std::cout);
+
+    for (const BatchResult& result : results) {
+        if (!result.success)
+            return 1;
+    }
+    return 0;
+}
+
+
+// Renders an OBJ file into a PNG or PPM image without a display.
+int runRender(const std::string& inputFile, const std::string& imageFile, int width, int height, const std::string& shadingName) {
+    MeshArrays arrays;
+    loadOBJ(inputFile, arrays);
+    if (arrays.faceCount() == 0)
+        return 1;
+
+    Mesh renderedMesh(arrays);
+    ThreadPool pool;
+    SoftwareRasterizer rasterizer(width, height, &pool);
+
+    auto start = std::chrono::steady_clock::now();
+    rasterizer.render(renderedMesh, shadingName == "flat" ? FLAT : GOURAUD);
+    std::cout << "Rendered " << renderedMesh.faces.size() << " faces at " << width << "x" << height << " in "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+    return rasterizer.save(imageFile) ? 0 : 1;
+}
+
+
+// Reduces an OBJ file to a coarse control cage of at most targetFaces triangles.
+int runDecimate(const std::string& inputFile, int targetFaces, const std::string& outputFile) {
+    MeshArrays arrays;
+    loadOBJ(inputFile, arrays);
+    if (arrays.faceCount() == 0 || targetFaces < 1)
+        return 1;
+
+    Mesh denseMesh(arrays);
+    std::unique_ptr<Mesh> cage(MeshDecimation::decimate(denseMesh, targetFaces));
+    return saveOBJ(outputFile, *cage) ? 0 : 1;
+}
+
+
+// Moves one control vertex of a subdivided OBJ file and updates only the levels around it.
+int runEdit(const std::string& schemeName, int levels, const std::string& inputFile, const std::string& outputFile,
+    int vertexNumber, const float offset[3]) {
+    LoopSubdivision loop = LoopSubdivision();
+    ButterflySubdivision butterfly = ButterflySubdivision();
+    Sqrt3Subdivision sqrt3 = Sqrt3Subdivision();
+
+    if (schemeName != "loop" && schemeName != "butterfly" && schemeName != "sqrt3") {
+        std::cerr << "Unknown subdivision scheme: " << schemeName << std::endl;
+        return 1;
+    }
+    TriangleSubdivison& scheme = schemeName == "sqrt3" ? static_cast<TriangleSubdivison&>(sqrt3)
+        : schemeName == "loop" ? static_cast<TriangleSubdivison&>(loop) : butterfly;
+
+    MeshArrays arrays;
+    loadOBJ(inputFile, arrays);
+    if (arrays.faceCount() == 0)
+        return 1;
+    // vertices are numbered from 1 as in the OBJ file
+    if (vertexNumber < 1 || vertexNumber > static_cast<int>(arrays.vertexCount())) {
+        std::cerr << "No vertex " << vertexNumber << " in " << inputFile << std::endl;
+        return 1;
+    }
+    int v = vertexNumber - 1;
+    std::vector<float> moved(arrays.positions.begin() + v * 3, arrays.positions.begin() + v * 3 + 3);
+    for (int k = 0; k < 3; ++k) moved[k] += offset[k];
+
+    auto start = std::chrono::steady_clock::now();
+    IncrementalSubdivision subdivision(scheme, schemeName != "butterfly");
+    if (!subdivision.build(TriangleMesh(std::move(arrays)), levels))
+        return 1;
+    double buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    size_t recomputed = subdivision.moveControlVertices({ v }, moved);
+    double editMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const TriangleMesh& finest = subdivision.getLevel(subdivision.levelCount() - 1);
+    std::cout << "moved v" << vertexNumber << ": recomputed " << recomputed << " vertices on all levels, "
+        << subdivision.getDirtyVertices().size() << " of " << finest.vertexCount() << " on level " << levels
+        << " in " << editMilliseconds << " ms (building the levels took " << buildMilliseconds << " ms, "
+        << MemoryEstimate::formatBytes(subdivision.memoryUsage()) << " kept)" << std::endl;
+    return saveOBJ(outputFile, finest) ? 0 : 1;
+}
+
+
+// Stores an OBJ file as a progressive stream over levels subdivisions of a cage. Without a fine mesh
+// the plain subdivision of the cage is stored.
+int runEncode(const std::string& schemeName, int levels, const std::string& cageFile, const std::string& outputFile,
+    const std::string& fineFile, int quantizationBits) {
+    if (schemeName != "loop" && schemeName != "butterfly" && schemeName != "sqrt3") {
+        std::cerr << "Unknown subdivision scheme: " << schemeName << std::endl;
+        return 1;
+    }
+
+    MeshArrays arrays;
+    loadOBJ(cageFile, arrays);
+    if (arrays.faceCount() == 0)
+        return 1;
+    TriangleMesh cage(std::move(arrays));
+
+    std::vector<float> finePositions;
+    if (!fineFile.empty()) {
+        MeshArrays fine;
+        loadOBJ(fineFile, fine);
+        if (fine.faceCount() == 0)
+            return 1;
+        finePositions = std::move(fine.positions);
+    }
+    else {
+        LoopSubdivision loop = LoopSubdivision();
+        ButterflySubdivision butterfly = ButterflySubdivision();
+        Sqrt3Subdivision sqrt3 = Sqrt3Subdivision();
+        TriangleSubdivison& scheme = schemeName == "sqrt3" ? static_cast<TriangleSubdivison&>(sqrt3)
+            : schemeName == "loop" ? static_cast<TriangleSubdivison&>(loop) : butterfly;
+        TriangleMesh level = cage;
+        for (int l = 0; l < levels; ++l) {
+            scheme.setLevel(l);
+            scheme.subdivide(level, schemeName != "butterfly");
+        }
+        finePositions = std::move(level.positions);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> stream;
+    float maxError = 0.0f;
+    if (!MultiresEncoder::encode(schemeName, cage, finePositions, levels, quantizationBits, stream, &maxError))
+        return 1;
+    std::cout << "encoded " << finePositions.size() / 3 << " vertices into " << MemoryEstimate::formatBytes(stream.size()) << " ("
+        << MemoryEstimate::formatBytes(finePositions.size() * sizeof(float)) << " as floats) in "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+        << " ms, max error " << maxError << std::endl;
+
+    std::ofstream file(outputFile, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open the file: " << outputFile << std::endl;
+        return 1;
+    }
+    file.write(reinterpret_cast<const char*>(stream.data()), stream.size());
+    return file ? 0 : 1;
+}
+
+
+// Decodes a progressive stream as if it arrived over a network, reporting when each level is
+// available, and saves the given level or the finest one.
+int runDecode(const std::string& inputFile, const std::string& outputFile, int stopLevel) {
+    std::ifstream file(inputFile, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not open the file: " << inputFile << std::endl;
+        return 1;
+    }
+
+    const size_t packetSize = 64 * 1024;
+    std::vector<char> packet(packetSize);
+    MultiresDecoder decoder;
+    size_t received = 0;
+    int shown = -1;
+    while (file && (stopLevel < 0 || shown < stopLevel)) {
+        file.read(packet.data(), packetSize);
+        size_t count = static_cast<size_t>(file.gcount());
+        if (count == 0)
+            break;
+        received += count;
+        decoder.append(reinterpret_cast<const uint8_t*>(packet.data()), count);
+
+        int level = decoder.update();
+        if (decoder.failed())
+            return 1;
+        for (; shown < level; ++shown)
+            std::cout << "level " << shown + 1 << " of " << decoder.levelCount() << " after " << MemoryEstimate::formatBytes(received) << std::endl;
+    }
+    if (decoder.decodedLevel() < 0 || (stopLevel >= 0 && decoder.decodedLevel() < stopLevel)) {
+        std::cerr << "The stream ended at level " << decoder.decodedLevel() << std::endl;
+        return 1;
+    }
+    return saveOBJ(outputFile, decoder.getMesh()) ? 0 : 1;
+}
+
+
 // Main routine.
 int main(int argc, char** argv)
 {
+    // Subdivison --out-of-core <loop|butterfly> <levels> <input.obj> <output.obj>
+    if (argc >= 6 && std::string(argv[1]) == "--out-of-core") {
+        return runOutOfCore(argv[2], std::atoi(argv[3]), argv[4], argv[5]);
+    }
+
+    // Subdivison --stream <loop|butterfly> <levels> <input.obj> <output.stl>
+    if (argc >= 6 && std::string(argv[1]) == "--stream") {
+        return runStream(argv[2], std::atoi(argv[3]), argv[4], argv[5]);
+    }
+
+    // Subdivison --serve <socket> <cache directory> [budget MB] [threads]
+    if (argc >= 4 && std::string(argv[1]) == "--serve") {
+        return runServer(argv[2], argv[3], (argc >= 5 ? std::strtoull(argv[4], nullptr, 10) : 1024) << 20, argc >= 6 ? std::atoi(argv[5]) : 0);
+    }
+
+    // Subdivison --request <socket> <loop|butterfly|sqrt3> <levels> <input.obj> [output.obj]
+    if (argc >= 6 && std::string(argv[1]) == "--request") {
+        return runRequest(argv[2], argv[3], std::atoi(argv[4]), argv[5], argc >= 7 ? argv[6] : "");
+    }
+
+    // Subdivison --stop-server <socket>
+    if (argc >= 3 && std::string(argv[1]) == "--stop-server") {
+        return SubdivisionClient(argv[2]).shutdown() ? 0 : 1;
+    }
+
+    // Subdivison --batch <manifest.txt> [threads]
+    if (argc >= 3 && std::string(argv[1]) == "--batch") {
+        return runBatch(argv[2], argc >= 4 ? std::atoi(argv[3]) : 0);
+    }
+
+    // Subdivison --edit <loop|butterfly|sqrt3> <levels> <input.obj> <output.obj> <vertex> <dx> <dy> <dz>
+    if (argc >= 10 && std::string(argv[1]) == "--edit") {
+        const float offset[3] = { std::strtof(argv[7], nullptr), std::strtof(argv[8], nullptr), std::strtof(argv[9], nullptr) };
+        return runEdit(argv[2], std::atoi(argv[3]), argv[4], argv[5], std::atoi(argv[6]), offset);
+    }
+
+    // Subdivison --decimate <input.obj> <faces> <output.obj>
+    if (argc >= 5 && std::string(argv[1]) == "--decimate") {
+        return runDecimate(argv[2], std::atoi(argv[3]), argv[4]);
+    }
+
+    // Subdivison --render <input.obj> <output.png|ppm> [width] [height] [flat|gouraud]
+    if (argc >= 4 && std::string(argv[1]) == "--render") {
+        return runRender(argv[2], argv[3], argc >= 5 ? std::atoi(argv[4]) : 1024, argc >= 6 ? std::atoi(argv[5]) : 1024,
+            argc >= 7 ? argv[6] : "gouraud");
+    }
+
+    // Subdivison --encode <loop|butterfly|sqrt3> <levels> <cage.obj> <output.sdm> [fine.obj] [bits]
+    if (argc >= 6 && std::string(argv[1]) == "--encode") {
+        return runEncode(argv[2], std::atoi(argv[3]), argv[4], argv[5], argc >= 7 ? argv[6] : "", argc >= 8 ? std::atoi(argv[7]) : 16);
+    }
+
+    // Subdivison --decode <input.sdm> <output.obj> [level]
+    if (argc >= 4 && std::string(argv[1]) == "--decode") {
+        return runDecode(argv[2], argv[3], argc >= 5 ? std::atoi(argv[4]) : -1);
+    }
+
+    // Subdivison --self-test [work directory]
+    if (argc >= 2 && std::string(argv[1]) == "--self-test") {
+        return SelfTest::run(argc >= 3 ? argv[2] : ".") ? 0 : 1;
+    }
 
     std::string objFile = "globe.obj";
 
@@ -552,12 +1137,14 @@ int main(int argc, char** argv)
 
     glutPassiveMotionFunc(mouseMove); // mouse movement
     glutMouseFunc(mouseClick);        // mouse clicks
+    glutMotionFunc(mouseDrag);        // vertex dragging
 
 	glewExperimental = GL_TRUE;
 	glewInit();
 
 	setup();
     Shadings::setupLighting();
+    frameTimer.initialize();
 
 	glutMainLoop();
 }
\ No newline at end of file
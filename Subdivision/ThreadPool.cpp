@@ -0,0 +1,115 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+thread_local ThreadPool* ThreadPool::currentPool = nullptr;
+thread_local int ThreadPool::currentWorker = -1;
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    stopping = true;
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::threadCount() const
+{
+    return static_cast<int>(workers.size());
+}
+
+void ThreadPool::submit(std::function<void()> task, TaskGroup* group)
+{
+    if (group) group->pending++;
+
+    // a worker keeps its own subtasks local, outside threads spread work round-robin
+    int queueIdx = currentPool == this ? currentWorker : static_cast<int>(nextQueue++ % queues.size());
+    {
+        std::lock_guard<std::mutex> lock(queues[queueIdx]->mutex);
+        queues[queueIdx]->tasks.push_back({ std::move(task), group });
+    }
+    queuedTasks++;
+    wakeUp.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup& group)
+{
+    int ownQueue = currentPool == this ? currentWorker : -1;
+    while (!group.isDone()) {
+        if (!runOne(ownQueue)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool ThreadPool::runOne(int ownQueue)
+{
+    Task task;
+    bool found = false;
+
+    if (ownQueue >= 0) {
+        WorkQueue& queue = *queues[ownQueue];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // steal the oldest task of another worker, those tend to be the largest
+    for (size_t i = 1; !found && i <= queues.size(); ++i) {
+        int victim = static_cast<int>((ownQueue + i) % queues.size());
+        WorkQueue& queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found)
+        return false;
+
+    queuedTasks--;
+    try {
+        task.function();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: uncaught exception in pool task: " << e.what() << std::endl;
+    }
+    if (task.group) task.group->pending--;
+    return true;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (!stopping) {
+        if (!runOne(index)) {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait_for(lock, std::chrono::milliseconds(5), [this]() { return stopping || queuedTasks > 0; });
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops its own tasks at the
+// back and steals from the front of the others when it runs dry. Tasks may submit further tasks
+// and wait for them; a waiting thread keeps running queued tasks instead of blocking a worker.
+class ThreadPool
+{
+public:
+    // counts the unfinished tasks submitted with it
+    class TaskGroup {
+    public:
+        bool isDone() const { return pending.load() == 0; }
+    private:
+        friend class ThreadPool;
+        std::atomic<int> pending{ 0 };
+    };
+
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    void submit(std::function<void()> task, TaskGroup* group = nullptr);
+    void wait(TaskGroup& group);
+    int threadCount() const;
+
+private:
+    struct Task {
+        std::function<void()> function;
+        TaskGroup* group;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stopping{ false };
+    std::atomic<int> queuedTasks{ 0 };
+    std::atomic<unsigned> nextQueue{ 0 };
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+
+    static thread_local ThreadPool* currentPool;
+    static thread_local int currentWorker;
+
+    bool runOne(int ownQueue);
+    void workerLoop(int index);
+};
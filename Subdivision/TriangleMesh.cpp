@@ -0,0 +1,249 @@
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+    // fine half-edges of a face split in four, in the order of rebuildFace:
+    // (c0 e0 e2) (e0 e1 e2) (e0 c1 e1) (e2 e1 c2). The first half of coarse edge k leaves c_k,
+    // the second half ends at c_k+1.
+    const int firstHalf[3] = { 0, 7, 11 };
+    const int secondHalf[3] = { 6, 10, 2 };
+}
+
+TriangleMesh::RingIterator& TriangleMesh::RingIterator::operator++()
+{
+    current = mesh->next(mesh->twin(current));
+    if (current == start) current = -1;
+    return *this;
+}
+
+TriangleMesh::TriangleMesh(std::vector<float> positions, const std::vector<int>& triangles)
+    : positions(std::move(positions))
+{
+    build(triangles);
+}
+
+TriangleMesh::TriangleMesh(const Mesh& mesh)
+{
+    std::unordered_map<const Vertex*, int> vertexIndex;
+    vertexIndex.reserve(mesh.vertices.size());
+    positions.reserve(mesh.vertices.size() * 3);
+    for (const Vertex* v : mesh.vertices) {
+        vertexIndex[v] = static_cast<int>(vertexIndex.size());
+        positions.push_back(v->x);
+        positions.push_back(v->y);
+        positions.push_back(v->z);
+    }
+
+    std::vector<int> triangles;
+    triangles.reserve(mesh.faces.size() * 3);
+    for (const Face* face : mesh.faces) {
+        int first = vertexIndex[face->edge->origin];
+        for (HalfEdge* he = face->edge->next; he->next != face->edge; he = he->next) {
+            triangles.push_back(first);
+            triangles.push_back(vertexIndex[he->origin]);
+            triangles.push_back(vertexIndex[he->next->origin]);
+        }
+    }
+    build(triangles);
+}
+
+TriangleMesh::TriangleMesh(MeshArrays arrays)
+    : positions(std::move(arrays.positions))
+{
+    std::vector<int> triangles;
+    triangles.reserve(arrays.faceCount() * 3);
+    for (size_t f = 0; f < arrays.faceCount(); ++f) {
+        const int* face = &arrays.faceIndices[arrays.faceOffsets[f]];
+        int size = arrays.faceOffsets[f + 1] - arrays.faceOffsets[f];
+        for (int i = 1; i + 1 < size; ++i) {
+            triangles.push_back(face[0]);
+            triangles.push_back(face[i]);
+            triangles.push_back(face[i + 1]);
+        }
+    }
+    build(triangles);
+}
+
+TriangleMesh::TriangleMesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos)
+    : TriangleMesh(MeshArrays(facesIndices, verticesPos)) {}
+
+void TriangleMesh::build(const std::vector<int>& triangles)
+{
+    faces = static_cast<int>(triangles.size() / 3);
+    int halfEdges = faces * 3;
+    int vertices = vertexCount();
+    origins.assign(triangles.begin(), triangles.begin() + halfEdges);
+    twins.assign(halfEdges, -1);
+
+    // bucket half-edges by origin, so a twin is searched only among the edges leaving the destination
+    std::vector<int> bucketOffsets(vertices + 1, 0);
+    for (int h = 0; h < halfEdges; ++h) bucketOffsets[origins[h] + 1]++;
+    for (int v = 0; v < vertices; ++v) bucketOffsets[v + 1] += bucketOffsets[v];
+    std::vector<int> outgoingHalfEdges(halfEdges);
+    std::vector<int> fill(bucketOffsets.begin(), bucketOffsets.end() - 1);
+    for (int h = 0; h < halfEdges; ++h) outgoingHalfEdges[fill[origins[h]]++] = h;
+
+    std::vector<int> boundaryTwins;
+    for (int h = 0; h < halfEdges; ++h) {
+        if (twins[h] >= 0)
+            continue;
+        int destination = origins[next(h)];
+        for (int i = bucketOffsets[destination]; i < bucketOffsets[destination + 1]; ++i) {
+            int candidate = outgoingHalfEdges[i];
+            if (twins[candidate] < 0 && origins[next(candidate)] == origins[h]) {
+                twins[h] = candidate;
+                twins[candidate] = h;
+                break;
+            }
+        }
+        if (twins[h] < 0)
+            boundaryTwins.push_back(h);
+    }
+
+    // boundary half-edges run against their face half-edge and are chained by origin
+    std::vector<int> boundaryByOrigin(vertices, -1);
+    origins.reserve(halfEdges + boundaryTwins.size());
+    twins.reserve(halfEdges + boundaryTwins.size());
+    for (int h : boundaryTwins) {
+        int b = static_cast<int>(origins.size());
+        twins[h] = b;
+        twins.push_back(h);
+        origins.push_back(origins[next(h)]);
+        boundaryByOrigin[origins.back()] = b;
+    }
+    boundaryNext.resize(boundaryTwins.size());
+    for (size_t i = 0; i < boundaryTwins.size(); ++i) {
+        boundaryNext[i] = boundaryByOrigin[origins[boundaryTwins[i]]];
+    }
+
+    // boundary half-edges come last, so a boundary vertex starts its fan at the boundary
+    vertexHalfEdges.assign(vertices, -1);
+    for (int h = 0; h < halfEdgeCount(); ++h) vertexHalfEdges[origins[h]] = h;
+}
+
+Mesh* TriangleMesh::toMesh(ThreadPool* pool) const
+{
+    MeshArrays arrays;
+    arrays.positions = positions;
+    arrays.faceIndices.assign(origins.begin(), origins.begin() + faces * 3);
+    arrays.faceOffsets.resize(faces + 1);
+    for (int f = 0; f <= faces; ++f) arrays.faceOffsets[f] = f * 3;
+    return new Mesh(arrays, 0.0f, pool);
+}
+
+int TriangleMesh::valence(int v) const
+{
+    int n = 0;
+    for (int neighbor : oneRing(v)) {
+        (void)neighbor;
+        n++;
+    }
+    return n;
+}
+
+void TriangleMesh::split(TriangleMesh& fine, std::vector<int>& edgeHalfEdges) const
+{
+    int halfEdges = faces * 3;
+    int vertices = vertexCount();
+    int boundaries = boundaryCount();
+
+    // one new vertex per edge, numbered in the order of the half-edge that owns it
+    std::vector<int> edgeVertices(halfEdges);
+    edgeHalfEdges.clear();
+    edgeHalfEdges.reserve((halfEdges + boundaries) / 2);
+    for (int h = 0; h < halfEdges; ++h) {
+        if (isBoundary(twins[h]) || h < twins[h]) {
+            edgeVertices[h] = vertices + static_cast<int>(edgeHalfEdges.size());
+            edgeHalfEdges.push_back(h);
+        }
+    }
+    for (int h = 0; h < halfEdges; ++h) {
+        if (!isBoundary(twins[h]) && twins[h] < h)
+            edgeVertices[h] = edgeVertices[twins[h]];
+    }
+
+    int fineHalfEdges = faces * 12;
+    fine.faces = faces * 4;
+    fine.positions.assign((vertices + edgeHalfEdges.size()) * 3, 0.0f);
+    std::copy(positions.begin(), positions.end(), fine.positions.begin());
+    fine.origins.resize(fineHalfEdges + boundaries * 2);
+    fine.twins.resize(fineHalfEdges + boundaries * 2);
+    fine.boundaryNext.resize(boundaries * 2);
+
+    for (int f = 0; f < faces; ++f) {
+        int c0 = origins[f * 3], c1 = origins[f * 3 + 1], c2 = origins[f * 3 + 2];
+        int e0 = edgeVertices[f * 3], e1 = edgeVertices[f * 3 + 1], e2 = edgeVertices[f * 3 + 2];
+        const int corners[12] = { c0, e0, e2, e0, e1, e2, e0, c1, e1, e2, e1, c2 };
+        int* fineOrigins = &fine.origins[f * 12];
+        int* fineTwins = &fine.twins[f * 12];
+        std::copy(corners, corners + 12, fineOrigins);
+
+        // the edges of the middle face
+        fineTwins[1] = f * 12 + 5; fineTwins[5] = f * 12 + 1;
+        fineTwins[3] = f * 12 + 8; fineTwins[8] = f * 12 + 3;
+        fineTwins[4] = f * 12 + 9; fineTwins[9] = f * 12 + 4;
+
+        // the halves of an edge pair up crosswise with the halves of its twin
+        for (int k = 0; k < 3; ++k) {
+            int twin = twins[f * 3 + k];
+            if (isBoundary(twin)) {
+                int b = fineHalfEdges + (twin - halfEdges) * 2;
+                fineTwins[firstHalf[k]] = b + 1;
+                fineTwins[secondHalf[k]] = b;
+            }
+            else {
+                int g = twin / 3, j = twin % 3;
+                fineTwins[firstHalf[k]] = g * 12 + secondHalf[j];
+                fineTwins[secondHalf[k]] = g * 12 + firstHalf[j];
+            }
+        }
+    }
+
+    // boundary half-edge b splits into (b->origin, edge vertex) and (edge vertex, b->destination)
+    for (int i = 0; i < boundaries; ++i) {
+        int h = twins[halfEdges + i];
+        int f = h / 3, k = h % 3;
+        int b = fineHalfEdges + i * 2;
+        fine.origins[b] = origins[halfEdges + i];
+        fine.origins[b + 1] = edgeVertices[h];
+        fine.twins[b] = f * 12 + secondHalf[k];
+        fine.twins[b + 1] = f * 12 + firstHalf[k];
+        fine.boundaryNext[i * 2] = b + 1;
+        int next = boundaryNext[i];
+        fine.boundaryNext[i * 2 + 1] = next < 0 ? -1 : fineHalfEdges + (next - halfEdges) * 2;
+    }
+
+    fine.vertexHalfEdges.assign(vertices + edgeHalfEdges.size(), -1);
+    for (int h = 0; h < fine.halfEdgeCount(); ++h) fine.vertexHalfEdges[fine.origins[h]] = h;
+}
+
+size_t TriangleMesh::memoryUsage() const
+{
+    return sizeof(TriangleMesh) + positions.capacity() * sizeof(float)
+        + (origins.capacity() + twins.capacity() + boundaryNext.capacity() + vertexHalfEdges.capacity()) * sizeof(int);
+}
+
+size_t TriangleMesh::bytesFor(size_t vertices, size_t faces, size_t boundaryEdges)
+{
+    return sizeof(TriangleMesh) + vertices * (3 * sizeof(float) + sizeof(int))
+        + (faces * 3 + boundaryEdges) * 2 * sizeof(int) + boundaryEdges * sizeof(int);
+}
+
+size_t TriangleMesh::predictPeakBytes(int levels) const
+{
+    size_t vertices = vertexCount(), faceCount = faces, boundaries = boundaryCount();
+    size_t peak = memoryUsage();
+    for (int level = 0; level < levels; ++level) {
+        size_t edges = (faceCount * 3 + boundaries) / 2;
+        // both levels, the edge vertex table of split and the owner list of the edge vertices
+        size_t levelPeak = bytesFor(vertices, faceCount, boundaries) + bytesFor(vertices + edges, faceCount * 4, boundaries * 2)
+            + (faceCount * 3 + edges) * sizeof(int);
+        peak = std::max(peak, levelPeak);
+        vertices += edges;
+        faceCount *= 4;
+        boundaries *= 2;
+    }
+    return peak;
+}
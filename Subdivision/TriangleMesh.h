@@ -0,0 +1,88 @@
+#pragma once
+#include "HalfEdge.h"
+
+#include <string>
+#include <vector>
+
+// Triangle-only mesh in directed-edge form (Campagna et al. 1998). Half-edge h belongs to face
+// h / 3, so next and prev are index arithmetic and only origin and twin are stored. The boundary
+// half-edges follow the 3 * faceCount() face half-edges and are linked by boundaryNext, so walking
+// around a boundary vertex behaves as on a Mesh. Subdivision keeps the face order of rebuildFace:
+// face f splits into 4f..4f+3, and the twins of the new level are derived from the old ones.
+class TriangleMesh
+{
+public:
+    typedef int HalfEdgeHandle;
+    typedef int VertexHandle;
+
+    // neighbours of a vertex, in the order of Vertex::oneRing
+    class RingIterator {
+    public:
+        RingIterator(const TriangleMesh* mesh, int current, int start) : mesh(mesh), current(current), start(start) {}
+        int operator*() const { return mesh->origin(mesh->twin(current)); }
+        bool operator!=(const RingIterator& other) const { return current != other.current; }
+        RingIterator& operator++();
+    private:
+        const TriangleMesh* mesh;
+        int current;
+        int start;
+    };
+
+    class Ring {
+    public:
+        Ring(const TriangleMesh* mesh, int start) : mesh(mesh), start(start) {}
+        RingIterator begin() const { return RingIterator(mesh, start, start); }
+        RingIterator end() const { return RingIterator(mesh, -1, start); }
+    private:
+        const TriangleMesh* mesh;
+        int start;
+    };
+
+    std::vector<float> positions;       // x, y, z per vertex
+    std::vector<int> origins;           // per half-edge, boundary half-edges included
+    std::vector<int> twins;
+    std::vector<int> boundaryNext;      // next of boundary half-edge 3 * faceCount() + i, -1 if open
+    std::vector<int> vertexHalfEdges;   // an outgoing half-edge per vertex, a boundary one if it has one
+
+    TriangleMesh() = default;
+    // 0-based triangle corners, moved-in positions are kept without a copy
+    TriangleMesh(std::vector<float> positions, const std::vector<int>& triangles);
+    // polygons are split into triangle fans
+    explicit TriangleMesh(const Mesh& mesh);
+    explicit TriangleMesh(MeshArrays arrays);
+    TriangleMesh(const std::vector<std::vector<int>>& facesIndices, const std::vector<std::vector<float>>& verticesPos);
+
+    // the Mesh is built on the pool if one is given
+    Mesh* toMesh(ThreadPool* pool = nullptr) const;
+
+    int vertexCount() const { return static_cast<int>(positions.size() / 3); }
+    int faceCount() const { return faces; }
+    int halfEdgeCount() const { return static_cast<int>(origins.size()); }
+    int boundaryCount() const { return halfEdgeCount() - 3 * faces; }
+
+    bool isBoundary(int h) const { return h >= 3 * faces; }
+    int origin(int h) const { return origins[h]; }
+    int twin(int h) const { return twins[h]; }
+    int next(int h) const { return h < 3 * faces ? (h % 3 == 2 ? h - 2 : h + 1) : boundaryNext[h - 3 * faces]; }
+    int prev(int h) const { return h % 3 == 0 ? h + 2 : h - 1; }
+    int outgoing(int v) const { return vertexHalfEdges[v]; }
+
+    Ring oneRing(int v) const { return Ring(this, vertexHalfEdges[v]); }
+    int valence(int v) const;
+    // the name the vertex would get in a Mesh
+    std::string vertexName(int v) const { return "v" + std::to_string(v + 1); }
+
+    // Splits every face in four. fine gets the old vertices first and then one vertex per edge,
+    // edgeHalfEdges names the face half-edge of every new edge vertex. Positions are left to the scheme.
+    void split(TriangleMesh& fine, std::vector<int>& edgeHalfEdges) const;
+
+    size_t memoryUsage() const;
+    static size_t bytesFor(size_t vertices, size_t faces, size_t boundaryEdges);
+    // the largest footprint while the given number of levels are built, old and new level alive
+    size_t predictPeakBytes(int levels) const;
+
+private:
+    int faces = 0;
+
+    void build(const std::vector<int>& triangles);
+};
@@ -1,36 +1,114 @@
 #include "TriangleSubdivison.h"
 
-void TriangleSubdivison::subdivide(Mesh* mesh, bool moveVertices)
+#include <memory>
+
+void TriangleSubdivison::setProgressCallback(std::function<bool(float)> callback)
+{
+    progressCallback = callback;
+}
+
+bool TriangleSubdivison::reportProgress(float fraction)
+{
+    return !progressCallback || progressCallback(fraction);
+}
+
+void TriangleSubdivison::setThreadPool(ThreadPool* threadPool)
+{
+    pool = threadPool;
+}
+
+void TriangleSubdivison::setMemoryBudget(size_t bytes)
+{
+    memoryBudget = bytes;
+}
+
+bool TriangleSubdivison::exceededBudget() const
+{
+    return budgetExceeded;
+}
+
+size_t TriangleSubdivison::getPeakBytes() const
+{
+    return peakBytes;
+}
+
+Vertex* TriangleSubdivison::placeVertex(Vertex* v, const Stencil& stencil)
+{
+    stencil.place(v);
+    if (channelRefiner)
+        channelRefiner->record(v, stencil);
+    return v;
+}
+
+bool TriangleSubdivison::subdivide(Mesh* mesh, bool moveVertices)
 {
     std::cout << "starting subdivision process" << std::endl;
-    std::unordered_map<HalfEdge*, Vertex*> edgeVertexMap;
 
-    for (HalfEdge* he : mesh->halfEdges) {
-        if (!edgeVertexMap[he] && !edgeVertexMap[he->twin]) {
-            edgeVertexMap[he] = he->isBoundaryEdge()
-                ? createBoundaryVertex(he, mesh)
-                : createInteriorVertex(he, mesh);
-            edgeVertexMap[he->twin] = edgeVertexMap[he]; // Share new vertex
-        }
+    LevelEstimate estimate = MemoryEstimate::next(MemoryEstimate::current(*mesh), moveVertices);
+    budgetExceeded = memoryBudget > 0 && estimate.peakBytes > memoryBudget;
+    peakBytes = 0;
+    if (budgetExceeded) {
+        std::cout << "refusing subdivison: the next level needs about " << MemoryEstimate::formatBytes(estimate.peakBytes)
+            << ", the budget is " << MemoryEstimate::formatBytes(memoryBudget) << std::endl << std::endl;
+        return false;
     }
+
+    std::unordered_map<HalfEdge*, Vertex*> edgeVertexMap;
+    std::vector<Vertex*> newVertices;
+
+    std::unique_ptr<ChannelRefiner> refiner(mesh->channels.empty() ? nullptr : new ChannelRefiner(*mesh));
+    channelRefiner = refiner.get();
+
+    // the mesh is only read until every new position is known, so a cancel just drops the new vertices
+    auto cancel = [&]() {
+        channelRefiner = nullptr;
+        std::unordered_set<Vertex*> created(newVertices.begin(), newVertices.end());
+        for (const auto& pair : edgeVertexMap) created.insert(pair.second);
+        for (Vertex* v : created) delete v;
+        std::cout << "cancelled subdivison process" << std::endl << std::endl;
+        return false;
+    };
+
+    if (!createEdgeVertices(mesh, edgeVertexMap) || !reportProgress(0.3f))
+        return cancel();
     std::cout << "created new vertices" << std::endl;
+    if (refiner)
+        refiner->mapEdges(*mesh, edgeVertexMap);
+
+    size_t edgeVertexMapBytes = MemoryEstimate::hashBytes(edgeVertexMap.size(), sizeof(std::pair<HalfEdge* const, Vertex*>), edgeVertexMap.bucket_count());
+    size_t edgeVertexBytes = edgeVertexMap.size() / 2 * sizeof(Vertex);
+    peakBytes = mesh->memoryUsage() + edgeVertexBytes + edgeVertexMapBytes;
 
     // move old vertices
     if (moveVertices){
-        std::vector<Vertex*> newVertices;
-        for (const auto& vertex : mesh->vertices) {
-            Vertex* movedVertex = moveVertex(vertex, mesh);
-            newVertices.push_back(movedVertex);
+        if (!moveOldVertices(mesh, newVertices) || !reportProgress(0.6f))
+            return cancel();
+
+        std::unordered_map<Vertex*, Vertex*> movedVertices;
+        for (size_t i = 0; i < mesh->vertices.size(); ++i) {
+            movedVertices[mesh->vertices[i]] = newVertices[i];
+        }
+        peakBytes = std::max(peakBytes, mesh->memoryUsage() + edgeVertexBytes + edgeVertexMapBytes
+            + newVertices.size() * sizeof(Vertex) + newVertices.capacity() * sizeof(Vertex*)
+            + MemoryEstimate::hashBytes(movedVertices.size(), sizeof(std::pair<Vertex* const, Vertex*>), movedVertices.bucket_count()));
+
+        // relink only after every vertex is moved, so all of them read the old positions
+        for (HalfEdge* he : mesh->halfEdges) {
+            he->origin = movedVertices[he->origin];
+        }
+        for (Vertex* vertex : mesh->vertices) {
+            mesh->vertexNormals.erase(vertex);
+            delete vertex;
         }
-        // TODO: delete from memory to prevent memory leak
         mesh->vertices = newVertices;
         std::cout << "moved old vertices" << std::endl;
     }
 
 
-    // add new vertices
+    // add new vertices (every edge vertex is mapped from both of its half-edges)
+    std::unordered_set<Vertex*> addedVertices;
     for (const auto& pair : edgeVertexMap) {
-        if (std::find(mesh->vertices.begin(), mesh->vertices.end(), pair.second) == mesh->vertices.end())
+        if (addedVertices.insert(pair.second).second)
             mesh->vertices.push_back(pair.second);
     }
 
@@ -42,16 +120,120 @@ void TriangleSubdivison::subdivide(Mesh* mesh, bool moveVertices)
         rebuildFace(f, mesh, newHalfEdges, newFaces, edgeVertexMap);
     }
     std::cout << "built new faces" << std::endl;
+    reportProgress(0.7f);
 
-    // TODO: delete from memory to prevent memory leak
+    peakBytes = std::max(peakBytes, mesh->memoryUsage() + edgeVertexMapBytes
+        + MemoryEstimate::hashBytes(addedVertices.size(), sizeof(Vertex*), addedVertices.bucket_count())
+        + newHalfEdges.size() * sizeof(HalfEdge) + newHalfEdges.capacity() * sizeof(HalfEdge*)
+        + newFaces.size() * sizeof(Face) + newFaces.capacity() * sizeof(Face*));
+
+    // release the previous level
+    for (HalfEdge* he : mesh->halfEdges) delete he;
+    for (Face* f : mesh->faces) {
+        mesh->faceNormals.erase(f);
+        delete f;
+    }
     mesh->halfEdges = newHalfEdges;
     mesh->faces = newFaces;
 
-    mesh->createTwinEdges();
+    mesh->createTwinEdges(pool);
+    if (refiner) {
+        refiner->refine(*mesh);
+        channelRefiner = nullptr;
+        std::cout << "refined " << mesh->channels.size() << " attribute channels" << std::endl;
+    }
+    reportProgress(0.8f);
+
+    // the twin search buckets are counted from the real element counts
+    size_t boundaryEdges = mesh->halfEdges.size() - mesh->faces.size() * 3;
+    peakBytes = std::max(peakBytes, mesh->memoryUsage()
+        + MemoryEstimate::hashBytes(mesh->vertices.size(), sizeof(std::pair<Vertex* const, std::vector<HalfEdge*>>))
+        + mesh->halfEdges.size() * sizeof(HalfEdge*)
+        + MemoryEstimate::hashBytes(boundaryEdges, sizeof(std::pair<Vertex* const, HalfEdge*>)));
 
     Shadings::calculateNormals(mesh);
+    reportProgress(1.0f);
+
+    peakBytes = std::max(peakBytes, mesh->memoryUsage());
+    std::cout << "peak memory " << MemoryEstimate::formatBytes(peakBytes)
+        << " (predicted " << MemoryEstimate::formatBytes(estimate.peakBytes) << ")" << std::endl;
 
     std::cout << "finished subdivison process" << std::endl << std::endl;
+    return true;
+}
+
+bool TriangleSubdivison::subdivide(TriangleMesh& mesh, bool moveVertices)
+{
+    std::cout << "starting subdivision process" << std::endl;
+
+    size_t predictedPeakBytes = mesh.predictPeakBytes(1);
+    budgetExceeded = memoryBudget > 0 && predictedPeakBytes > memoryBudget;
+    peakBytes = 0;
+    if (budgetExceeded) {
+        std::cout << "refusing subdivison: the next level needs about " << MemoryEstimate::formatBytes(predictedPeakBytes)
+            << ", the budget is " << MemoryEstimate::formatBytes(memoryBudget) << std::endl << std::endl;
+        return false;
+    }
+
+    // the topology of the next level follows from the indices alone, the scheme only fills in positions
+    TriangleMesh fine;
+    std::vector<int> edgeHalfEdges;
+    mesh.split(fine, edgeHalfEdges);
+    std::cout << "built new faces" << std::endl;
+    if (!reportProgress(0.2f)) {
+        std::cout << "cancelled subdivison process" << std::endl << std::endl;
+        return false;
+    }
+
+    // split has released its edge vertex table by now, it was there together with both levels
+    peakBytes = mesh.memoryUsage() + fine.memoryUsage() + edgeHalfEdges.capacity() * sizeof(int)
+        + static_cast<size_t>(mesh.faceCount()) * 3 * sizeof(int);
+
+    if (!placeVertices(mesh, fine, edgeHalfEdges, moveVertices, false)) {
+        std::cout << "cancelled subdivison process" << std::endl << std::endl;
+        return false;
+    }
+    std::cout << "created new vertices" << std::endl;
+
+    mesh = std::move(fine);
+    reportProgress(1.0f);
+
+    std::cout << "peak memory " << MemoryEstimate::formatBytes(peakBytes)
+        << " (predicted " << MemoryEstimate::formatBytes(predictedPeakBytes) << ")" << std::endl;
+    std::cout << "finished subdivison process" << std::endl << std::endl;
+    return true;
+}
+
+bool TriangleSubdivison::subdivideWithStencils(TriangleMesh& mesh, bool moveVertices, StencilTable& stencils)
+{
+    int coarseVertices = mesh.vertexCount();
+    stencils.clear();
+    stencilTable = &stencils;
+    bool done = subdivide(mesh, moveVertices);
+    stencilTable = nullptr;
+    if (done)
+        stencils.finish(coarseVertices, mesh.vertexCount());
+    return done;
+}
+
+bool TriangleSubdivison::refinePatch(const TriangleMesh& coarse, TriangleMesh& fine, bool moveVertices)
+{
+    if (!splitsInFour())
+        return false;
+
+    std::vector<int> edgeHalfEdges;
+    coarse.split(fine, edgeHalfEdges);
+    // a patch is never cancelled
+    return placeVertices(coarse, fine, edgeHalfEdges, moveVertices, true);
+}
+
+bool TriangleSubdivison::refinePatchFace(const TriangleMesh& coarse, int face, bool moveVertices, float points[18])
+{
+    if (!splitsInFour())
+        return false;
+
+    placeFaceVertices(coarse, face, moveVertices, points);
+    return true;
 }
 
 void TriangleSubdivison::rebuildFace(Face* face, Mesh* mesh, std::vector<HalfEdge*>& newHalfEdges, std::vector<Face*>& newFaces, std::unordered_map<HalfEdge*, Vertex*>& edgeVertexMap)
@@ -75,11 +257,11 @@ void TriangleSubdivison::rebuildFace(Face* face, Mesh* mesh, std::vector<HalfEdg
 
 
     // new face 1
-    Face* nf1 = new Face();
+    Face* nf1 = new Face(mesh->nextFaceName());
 
-    HalfEdge* nhe1 = new HalfEdge();
-    HalfEdge* nhe2 = new HalfEdge();
-    HalfEdge* nhe3 = new HalfEdge();
+    HalfEdge* nhe1 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe2 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe3 = new HalfEdge(mesh->nextHalfEdgeName());
 
     nhe1->origin = ov1; nhe1->next = nhe2; nhe1->prev = nhe3; nhe1->incidentFace = nf1;
     nhe2->origin = nv1; nhe2->next = nhe3; nhe2->prev = nhe1; nhe2->incidentFace = nf1;
@@ -87,11 +269,11 @@ void TriangleSubdivison::rebuildFace(Face* face, Mesh* mesh, std::vector<HalfEdg
     nf1->edge = nhe1;
 
     // new face 2
-    Face* nf2 = new Face();
+    Face* nf2 = new Face(mesh->nextFaceName());
 
-    HalfEdge* nhe4 = new HalfEdge();
-    HalfEdge* nhe5 = new HalfEdge();
-    HalfEdge* nhe6 = new HalfEdge();
+    HalfEdge* nhe4 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe5 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe6 = new HalfEdge(mesh->nextHalfEdgeName());
 
     nhe4->origin = nv1; nhe4->next = nhe5; nhe4->prev = nhe6; nhe4->incidentFace = nf2;
     nhe5->origin = nv2; nhe5->next = nhe6; nhe5->prev = nhe4; nhe5->incidentFace = nf2;
@@ -99,11 +281,11 @@ void TriangleSubdivison::rebuildFace(Face* face, Mesh* mesh, std::vector<HalfEdg
     nf2->edge = nhe4;
 
     // new face 3
-    Face* nf3 = new Face();
+    Face* nf3 = new Face(mesh->nextFaceName());
 
-    HalfEdge* nhe7 = new HalfEdge();
-    HalfEdge* nhe8 = new HalfEdge();
-    HalfEdge* nhe9 = new HalfEdge();
+    HalfEdge* nhe7 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe8 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe9 = new HalfEdge(mesh->nextHalfEdgeName());
 
     nhe7->origin = nv1; nhe7->next = nhe8; nhe7->prev = nhe9; nhe7->incidentFace = nf3;
     nhe8->origin = ov2; nhe8->next = nhe9; nhe8->prev = nhe7; nhe8->incidentFace = nf3;
@@ -111,11 +293,11 @@ void TriangleSubdivison::rebuildFace(Face* face, Mesh* mesh, std::vector<HalfEdg
     nf3->edge = nhe7;
 
     // new face 4
-    Face* nf4 = new Face();
+    Face* nf4 = new Face(mesh->nextFaceName());
 
-    HalfEdge* nhe10 = new HalfEdge();
-    HalfEdge* nhe11 = new HalfEdge();
-    HalfEdge* nhe12 = new HalfEdge();
+    HalfEdge* nhe10 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe11 = new HalfEdge(mesh->nextHalfEdgeName());
+    HalfEdge* nhe12 = new HalfEdge(mesh->nextHalfEdgeName());
 
     nhe10->origin = nv3; nhe10->next = nhe11; nhe10->prev = nhe12; nhe10->incidentFace = nf4;
     nhe11->origin = nv2; nhe11->next = nhe12; nhe11->prev = nhe10; nhe11->incidentFace = nf4;
@@ -1,25 +1,201 @@
 #pragma once
 #include "HalfEdge.h"
-#include "globals.h"
+#include "MemoryEstimate.h"
 #include "Shadings.h"
+#include "SubdivisionStencil.h"
+#include "TriangleMesh.h"
 
 #include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <algorithm>
+#include <functional>
 
 
 class TriangleSubdivison
 {
 public:
-    void subdivide(Mesh* mesh, bool moveVertices);
+    // returns false if the progress callback cancelled the level or the memory budget refused it,
+    // the mesh is left unchanged then
+    virtual bool subdivide(Mesh* mesh, bool moveVertices);
+    // the same level on the directed-edge form, which has no attribute channels
+    virtual bool subdivide(TriangleMesh& mesh, bool moveVertices);
+    // the same level, stencils gets the stencil of every vertex placed by the scheme
+    bool subdivideWithStencils(TriangleMesh& mesh, bool moveVertices, StencilTable& stencils);
+    // One level of a small patch, without logging, budget or progress. The stencils are summed in
+    // the order of their positions, so patches that overlap agree on the bits of shared vertices.
+    // No member is written, several threads may refine patches with the same scheme.
+    // Returns false, with fine left empty, if the scheme does not split in four.
+    bool refinePatch(const TriangleMesh& coarse, TriangleMesh& fine, bool moveVertices);
+    // only the corners and edge points of one face of a patch, as refinePatch would place them:
+    // xyz of c0 c1 c2 e0 e1 e2, where e_k lies on the edge leaving c_k. False as refinePatch.
+    bool refinePatchFace(const TriangleMesh& coarse, int face, bool moveVertices, float points[18]);
+    // false for schemes that replace the whole level instead of splitting every face in four,
+    // they have no patch refinement
+    virtual bool splitsInFour() const { return true; }
     TriangleSubdivison() = default;
+    virtual ~TriangleSubdivison() = default;
 
-private:
-    virtual Vertex* createBoundaryVertex(HalfEdge* he, Mesh* mesh) = 0;
-    virtual Vertex* createInteriorVertex(HalfEdge* he, Mesh* mesh) = 0;
-    virtual Vertex* moveVertex(Vertex* v, Mesh* mesh) = 0;
+    // the level of the mesh the next call refines, for schemes whose rules alternate between levels
+    virtual void setLevel(int) {}
+
+    // called with the finished fraction of the level; returning false cancels it
+    void setProgressCallback(std::function<bool(float)> callback);
+
+    // the twins of a Mesh level are found by sorting on this pool, null for the hash search
+    void setThreadPool(ThreadPool* threadPool);
+
+    // levels predicted to need more than this are refused before allocating, 0 means no limit
+    void setMemoryBudget(size_t bytes);
+    bool exceededBudget() const;
+    // the largest footprint measured on the containers of the last level
+    size_t getPeakBytes() const;
 
 protected:
+    static const size_t progressStep = 4096;
+    std::function<bool(float)> progressCallback;
+    size_t memoryBudget = 0;
+    size_t peakBytes = 0;
+    ThreadPool* pool = nullptr;
+    bool budgetExceeded = false;
+    // set while a level of a mesh with attribute channels is built
+    ChannelRefiner* channelRefiner = nullptr;
+    // set while subdivideWithStencils runs, the TriangleMesh rules add their stencils to it
+    StencilTable* stencilTable = nullptr;
+
+    // one call per level, TriangleSubdivisonScheme runs the per element rules of a scheme.
+    // Both return false if cancelled, the vertices created so far are left in the outputs.
+    virtual bool createEdgeVertices(Mesh* mesh, std::unordered_map<HalfEdge*, Vertex*>& edgeVertexMap) = 0;
+    virtual bool moveOldVertices(Mesh* mesh, std::vector<Vertex*>& movedVertices) = 0;
+    // positions the vertices of a TriangleMesh level after split, returns false if cancelled.
+    // For a patch the stencils are summed in position order and no member is touched, no progress
+    // and no stencil table, so patches can be refined on several threads at once.
+    virtual bool placeVertices(const TriangleMesh& coarse, TriangleMesh& fine, const std::vector<int>& edgeHalfEdges, bool moveVertices,
+        bool patch) = 0;
+    virtual void placeFaceVertices(const TriangleMesh& coarse, int face, bool moveVertices, float points[18]) = 0;
+
+    bool reportProgress(float fraction);
+    // positions v from the stencil and keeps the stencil for the channels
+    Vertex* placeVertex(Vertex* v, const Stencil& stencil);
 	void rebuildFace(Face* face, Mesh* mesh, std::vector<HalfEdge*>& newHalfEdges, std::vector<Face*>& newFaces, std::unordered_map<HalfEdge*, Vertex*>& edgeVertexMap);
 };
 
+// Base of the concrete schemes. Scheme provides the non-virtual rules
+//     void boundaryStencil(const Topology& mesh, HalfEdgeHandle he, BasicStencil<VertexHandle>& stencil);
+//     void interiorStencil(const Topology& mesh, HalfEdgeHandle he, BasicStencil<VertexHandle>& stencil);
+//     void vertexStencil(const Topology& mesh, VertexHandle v, BasicStencil<VertexHandle>& stencil);
+// for Topology HalfEdgeTopology and TriangleMesh, called through the static type from the loops below.
+template <class Scheme>
+class TriangleSubdivisonScheme : public TriangleSubdivison
+{
+protected:
+    bool createEdgeVertices(Mesh* mesh, std::unordered_map<HalfEdge*, Vertex*>& edgeVertexMap) override
+    {
+        Scheme& scheme = static_cast<Scheme&>(*this);
+        Stencil stencil;
+
+        size_t processed = 0;
+        for (HalfEdge* he : mesh->halfEdges) {
+            if (!edgeVertexMap[he] && !edgeVertexMap[he->twin]) {
+                stencil.clear();
+                // the face half-edge of a boundary edge comes first, so check both sides
+                if (he->isBoundaryEdge() || he->twin->isBoundaryEdge())
+                    scheme.boundaryStencil(HalfEdgeTopology(), he, stencil);
+                else
+                    scheme.interiorStencil(HalfEdgeTopology(), he, stencil);
+                edgeVertexMap[he] = placeVertex(new Vertex(0.0f, 0.0f, 0.0f, mesh->nextVertexName()), stencil);
+                edgeVertexMap[he->twin] = edgeVertexMap[he]; // Share new vertex
+            }
+            if (++processed % progressStep == 0 && !reportProgress(0.3f * processed / mesh->halfEdges.size()))
+                return false;
+        }
+        return true;
+    }
+
+    bool moveOldVertices(Mesh* mesh, std::vector<Vertex*>& movedVertices) override
+    {
+        Scheme& scheme = static_cast<Scheme&>(*this);
+        Stencil stencil;
+
+        for (Vertex* vertex : mesh->vertices) {
+            stencil.clear();
+            scheme.vertexStencil(HalfEdgeTopology(), vertex, stencil);
+            movedVertices.push_back(placeVertex(new Vertex(vertex), stencil));
+            if (movedVertices.size() % progressStep == 0 && !reportProgress(0.3f + 0.3f * movedVertices.size() / mesh->vertices.size()))
+                return false;
+        }
+        return true;
+    }
+
+    bool placeVertices(const TriangleMesh& coarse, TriangleMesh& fine, const std::vector<int>& edgeHalfEdges, bool moveVertices,
+        bool patch) override
+    {
+        Scheme& scheme = static_cast<Scheme&>(*this);
+        IndexStencil stencil;
+        const float* positions = coarse.positions.data();
+        size_t vertexCount = coarse.vertexCount();
+        size_t total = edgeHalfEdges.size() + (moveVertices ? vertexCount : 0);
+
+        for (size_t e = 0; e < edgeHalfEdges.size(); ++e) {
+            int he = edgeHalfEdges[e];
+            stencil.clear();
+            if (coarse.isBoundary(coarse.twin(he)))
+                scheme.boundaryStencil(coarse, he, stencil);
+            else
+                scheme.interiorStencil(coarse, he, stencil);
+            if (patch)
+                stencil.sortByPosition(positions);
+            stencil.place(positions, &fine.positions[(vertexCount + e) * 3]);
+            if (stencilTable && !patch)
+                stencilTable->addRow(static_cast<int>(vertexCount + e), stencil);
+            if (!patch && (e + 1) % progressStep == 0 && !reportProgress(0.2f + 0.8f * (e + 1) / total))
+                return false;
+        }
+
+        // without moving, split has copied the old positions already
+        if (moveVertices) {
+            for (size_t v = 0; v < vertexCount; ++v) {
+                stencil.clear();
+                scheme.vertexStencil(coarse, static_cast<int>(v), stencil);
+                if (patch)
+                    stencil.sortByPosition(positions);
+                stencil.place(positions, &fine.positions[v * 3]);
+                if (stencilTable && !patch)
+                    stencilTable->addRow(static_cast<int>(v), stencil);
+                if (!patch && (v + 1) % progressStep == 0 && !reportProgress(0.2f + 0.8f * (edgeHalfEdges.size() + v + 1) / total))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void placeFaceVertices(const TriangleMesh& coarse, int face, bool moveVertices, float points[18]) override
+    {
+        Scheme& scheme = static_cast<Scheme&>(*this);
+        IndexStencil stencil;
+        const float* positions = coarse.positions.data();
+
+        for (int k = 0; k < 3; ++k) {
+            int he = face * 3 + k;
+            int v = coarse.origin(he);
+            if (moveVertices) {
+                stencil.clear();
+                scheme.vertexStencil(coarse, v, stencil);
+                stencil.sortByPosition(positions);
+                stencil.place(positions, &points[k * 3]);
+            }
+            else {
+                std::copy(positions + v * 3, positions + v * 3 + 3, &points[k * 3]);
+            }
+
+            stencil.clear();
+            if (coarse.isBoundary(coarse.twin(he)))
+                scheme.boundaryStencil(coarse, he, stencil);
+            else
+                scheme.interiorStencil(coarse, he, stencil);
+            stencil.sortByPosition(positions);
+            stencil.place(positions, &points[9 + k * 3]);
+        }
+    }
+};
+